@@ -1,7 +1,7 @@
 #version 330 core
+in vec3 vColor;
 out vec4 FragColor;
 
 void main() {
-    vec3 white = vec3(1.0, 1.0, 1.0);
-    FragColor = vec4(white, 1.0);
+    FragColor = vec4(vColor, 1.0);
 }
@@ -1,6 +1,15 @@
 #version 330 core
-layout (location = 0) in vec3 aPos;
+layout (location = 0) in vec2 aCorner;  // Corner of the unit quad
+layout (location = 1) in vec2 iPos;     // Top left pixel of the instance
+layout (location = 2) in vec2 iSize;    // Size in pixels
+layout (location = 3) in vec3 iColor;
+
+uniform vec2 uWindow;   // Window size in pixels
+
+out vec3 vColor;
 
 void main() {
-    gl_Position = vec4(aPos, 1.0);
+    vec2 pixel  = iPos + aCorner * iSize;
+    gl_Position = vec4((pixel / uWindow - 0.5) * 2.0, 0.0, 1.0);
+    vColor      = iColor;
 }
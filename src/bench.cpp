@@ -0,0 +1,279 @@
+// Microbenchmarks: build/bench [-o out.json] [-c baseline.json] [filter]
+// Every benchmark is warmed up, then timed over BENCH_REPS repetitions
+// long enough for the clock. Median and median absolute deviation keep
+// the odd preempted repetition from skewing the result. The workloads
+// are fixed, so runs on different commits compare.
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <algorithm>
+
+#include "collision.h"
+#include "game.h"
+#include "input.h"
+#include "renderer.h"
+#include "util/file.h"
+
+constexpr int    BENCH_REPS      = 21;
+constexpr double BENCH_REP_TIME  = 0.01;    // Seconds a repetition runs at least
+constexpr double BENCH_WARMUP    = 0.1;     // Seconds
+constexpr int    BENCH_MAX       = 32;      // Benchmarks in a run
+
+/// Monotonic time in seconds
+static double now() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/// Keep the compiler from dropping a result it can see isn't used
+template <typename T>
+static void keep(T const& value) {
+    asm volatile("" : : "r"(&value) : "memory");
+}
+
+struct BenchResult {
+    char const* name;
+    double      median_ns;  // Per operation
+    double      mad_ns;     // Median absolute deviation
+    double      min_ns;
+    long        iterations; // Operations in a repetition
+};
+
+typedef void (*BenchBody)(long iterations);
+
+static double median(double* values, int count) {
+    std::sort(values, values + count);
+    return count % 2 ? values[count / 2] : 0.5 * (values[count / 2 - 1] + values[count / 2]);
+}
+
+static BenchResult measure(char const* name, BenchBody body) {
+    // Warm up the caches and the branch predictors, and find out how
+    // many operations fill a repetition
+    long iterations = 1;
+    double start = now();
+    for (;;) {
+        double t = now();
+        body(iterations);
+        double elapsed = now() - t;
+        if (elapsed >= BENCH_REP_TIME && now() - start >= BENCH_WARMUP) break;
+        if (elapsed < BENCH_REP_TIME) iterations *= 2;
+    }
+
+    double samples[BENCH_REPS];
+    for (int rep = 0; rep < BENCH_REPS; rep++) {
+        double t = now();
+        body(iterations);
+        samples[rep] = (now() - t) * 1e9 / iterations;
+    }
+
+    BenchResult result = { name, 0, 0, 0, iterations };
+    result.min_ns    = *std::min_element(samples, samples + BENCH_REPS);
+    result.median_ns = median(samples, BENCH_REPS);
+
+    double deviations[BENCH_REPS];
+    for (int rep = 0; rep < BENCH_REPS; rep++) deviations[rep] = fabs(samples[rep] - result.median_ns);
+    result.mad_ns = median(deviations, BENCH_REPS);
+    return result;
+}
+
+// Inputs shared by the benchmarks, set up once
+constexpr int BOXES = 1024;
+static AABB     BOX[BOXES];
+static AABBPack PACK;
+static unsigned char HITS[BOXES];
+
+static void setup() {
+    srand(1);
+    aabb_pack_init(&PACK, BOXES);
+    for (int i = 0; i < BOXES; i++) {
+        BOX[i] = { { (float) (rand() % WIDTH), (float) (rand() % HEIGHT) }, { 10.0f + rand() % 30, 10.0f + rand() % 30 } };
+        aabb_pack_set(&PACK, i, BOX[i]);
+    }
+}
+
+static void bench_collision(long iterations) {
+    int hits = 0;
+    for (long i = 0; i < iterations; i++) hits += collision(BOX[i % BOXES], BOX[(i * 7 + 1) % BOXES]);
+    keep(hits);
+}
+
+static void bench_collision_pack(long iterations) {
+    for (long i = 0; i < iterations; i++) {
+        int hits = collision(BOX[i % BOXES], &PACK, HITS);
+        keep(hits);
+    }
+}
+
+static void bench_gen_instances(long iterations) {
+    Instance instances[3];
+    RenderState state = { 100.0f, 200.0f, { 400.0f, 225.0f } };
+    for (long i = 0; i < iterations; i++) {
+        state.ball.x = (float) (i % WIDTH);
+        keep(gen_instances(&state, instances));
+        keep(instances);
+    }
+}
+
+static void bench_update_ball(long iterations) {
+    Game game;
+    reset(&game);
+    for (long i = 0; i < iterations; i++) {
+        update_ball(&game.ball, game.lpad, game.rpad, 1.0f / TICK_RATE);
+        if (scored(&game)) reset(&game);
+    }
+    keep(game);
+}
+
+static void bench_update_paddles(long iterations) {
+    Game game;
+    reset(&game);
+    Input input = {0};
+    for (long i = 0; i < iterations; i++) {
+        // Sweep both paddles up and down
+        input.ldir = (i >> 8) & 1 ? 1 : -1;
+        input.rdir = -input.ldir;
+        keep(update_paddles(input, &game, 1.0f / TICK_RATE));
+    }
+    keep(game);
+}
+
+/// A key event from the callback through the queue to the simulation
+static void bench_key_callback(long iterations) {
+    static int const KEYS[] = { GLFW_KEY_A, GLFW_KEY_S, GLFW_KEY_J, GLFW_KEY_K };
+    for (long i = 0; i < iterations; i++) {
+        int key    = KEYS[(i >> 1) & 3];
+        int action = i & 1 ? GLFW_RELEASE : GLFW_PRESS;
+        key_callback(nullptr, key, 0, action, 0);
+
+        InputEvent event;
+        if (input_queue_peek(&INPUT_EVENTS, &event)) input_queue_pop(&INPUT_EVENTS);
+        keep(event);
+    }
+}
+
+static void bench_get_resource(long iterations) {
+    for (long i = 0; i < iterations; i++) {
+        FileView view;
+        if (get_resource("shader/default.vert", &view)) abort();
+        keep(view.data[0]);
+        release_file(&view);
+    }
+}
+
+static void bench_headless_tick(long iterations) {
+    Game game;
+    reset(&game);
+    for (long i = 0; i < iterations; i++) {
+        step(&game, bot_input(&game), 1.0f / TICK_RATE);
+        if (game.ball.pos.x < -WIDTH || game.ball.pos.x > 2 * WIDTH) reset(&game);
+    }
+    keep(game);
+}
+
+struct Bench {
+    char const* name;
+    BenchBody   body;
+};
+
+static Bench const BENCHES[] = {
+    { "collision",          bench_collision },
+    { "collision_pack",     bench_collision_pack },
+    { "gen_instances",      bench_gen_instances },
+    { "update_ball",        bench_update_ball },
+    { "update_paddles",     bench_update_paddles },
+    { "key_callback",       bench_key_callback },
+    { "get_resource",       bench_get_resource },
+    { "headless_tick",      bench_headless_tick },
+};
+
+/// Median of a benchmark in an earlier JSON output, 0 if it has none
+static double baseline_median(char const* json, long size, char const* name) {
+    char key[128];
+    snprintf(key, sizeof(key), "\"name\": \"%s\"", name);
+
+    // One benchmark per line, as written below. The file isn't terminated,
+    // nothing may read past its end.
+    char const* end = json + size;
+    char const* at  = (char const*) memmem(json, size, key, strlen(key));
+    if (!at) return 0;
+    char const* line_end = (char const*) memchr(at, '\n', end - at);
+    if (!line_end) line_end = end;
+
+    constexpr char FIELD[] = "\"median_ns\": ";
+    char const* field = (char const*) memmem(at, line_end - at, FIELD, sizeof(FIELD) - 1);
+    if (!field) return 0;
+    field += sizeof(FIELD) - 1;
+
+    char number[32];
+    long bytes = std::min<long>(line_end - field, sizeof(number) - 1);
+    memcpy(number, field, bytes);
+    number[bytes] = 0;
+    return atof(number);
+}
+
+int main(int argc, char** argv) {
+    char const* out_path      = nullptr;
+    char const* baseline_path = nullptr;
+    char const* filter        = nullptr;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "-o") && i + 1 < argc)         out_path = argv[++i];
+        else if (!strcmp(argv[i], "-c") && i + 1 < argc)    baseline_path = argv[++i];
+        else                                                filter = argv[i];
+    }
+
+    // The resources of the source tree, so the run doesn't depend on the cwd's contents
+    strcpy(RESOURCE.DIR, "resource/");
+    RESOURCE.BYTES = strlen(RESOURCE.DIR);
+
+    // key_callback stamps the events on the GLFW timer. The null platform
+    // needs no display.
+    glfwInitHint(GLFW_PLATFORM, GLFW_PLATFORM_NULL);
+    if (!glfwInit()) {
+        fputs("ERROR:GLFW:INIT\n", stderr);
+        return -1;
+    }
+
+    FileView baseline = {0};
+    if (baseline_path && map_file(baseline_path, &baseline)) {
+        glfwTerminate();
+        return -1;
+    }
+
+    setup();
+
+    BenchResult results[BENCH_MAX];
+    int count = 0;
+    for (Bench const& bench : BENCHES) {
+        if (filter && !strstr(bench.name, filter)) continue;
+
+        BenchResult r = measure(bench.name, bench.body);
+        results[count++] = r;
+
+        fprintf(stderr, "%-16s %10.2f ns  +- %6.2f  (min %.2f, %ld ops x %d)", r.name, r.median_ns, r.mad_ns, r.min_ns, r.iterations, BENCH_REPS);
+        double base = baseline.data ? baseline_median(baseline.data, baseline.size, r.name) : 0;
+        if (base > 0) fprintf(stderr, "  %+6.1f%%", (r.median_ns / base - 1) * 100);
+        fputc('\n', stderr);
+    }
+    release_file(&baseline);
+    aabb_pack_free(&PACK);
+
+    FILE* out = out_path ? fopen(out_path, "w") : stdout;
+    glfwTerminate();
+    if (!out) {
+        fprintf(stderr, "ERROR:BENCH:OPEN %s\n", out_path);
+        return -1;
+    }
+    fprintf(out, "{\n  \"reps\": %d,\n  \"benchmarks\": [\n", BENCH_REPS);
+    for (int i = 0; i < count; i++) {
+        BenchResult const& r = results[i];
+        fprintf(out, "    { \"name\": \"%s\", \"median_ns\": %.3f, \"mad_ns\": %.3f, \"min_ns\": %.3f, \"iterations\": %ld }%s\n",
+                r.name, r.median_ns, r.mad_ns, r.min_ns, r.iterations, i + 1 < count ? "," : "");
+    }
+    fputs("  ]\n}\n", out);
+    if (out != stdout) fclose(out);
+    return 0;
+}
@@ -0,0 +1,132 @@
+#include "broadphase.h"
+
+#include <stdlib.h>
+
+#include "game.h"
+
+/// Column or row of a coordinate, clamped to the grid
+static int cell_coord(float v, int cell_size, int cells) {
+    int c = (int) floorf(v / cell_size);
+    if (c < 0)          return 0;
+    if (c >= cells)     return cells - 1;
+    return c;
+}
+
+int grid_init(Grid* grid, int count, int cell_size) {
+    grid->cell_size = cell_size;
+    grid->cols      = (WIDTH  + cell_size - 1) / cell_size;
+    grid->rows      = (HEIGHT + cell_size - 1) / cell_size;
+    grid->count     = count;
+
+    grid->head = (int*) malloc(sizeof(int) * grid->cols * grid->rows);
+    grid->next = (int*) malloc(sizeof(int) * (count ? count : 1));
+    grid->prev = (int*) malloc(sizeof(int) * (count ? count : 1));
+    grid->cell = (int*) malloc(sizeof(int) * (count ? count : 1));
+
+    if (!grid->head || !grid->next || !grid->prev || !grid->cell) {
+        grid_free(grid);
+        return -1;
+    }
+
+    for (int c = 0; c < grid->cols * grid->rows; c++) grid->head[c] = -1;
+    for (int i = 0; i < count; i++) grid->cell[i] = -1;
+    return 0;
+}
+
+void grid_free(Grid* grid) {
+    free(grid->head);
+    free(grid->next);
+    free(grid->prev);
+    free(grid->cell);
+    *grid = {0};
+}
+
+int grid_update(Grid* grid, AABBPack const* pack) {
+    int moved = 0;
+    for (int i = 0; i < grid->count; i++) {
+        int col = cell_coord(pack->x[i], grid->cell_size, grid->cols);
+        int row = cell_coord(pack->y[i], grid->cell_size, grid->rows);
+        int c   = row * grid->cols + col;
+
+        int old = grid->cell[i];
+        if (c == old) continue;
+
+        // Unlink from the old cell
+        if (old >= 0) {
+            if (grid->prev[i] >= 0) grid->next[grid->prev[i]] = grid->next[i];
+            else                    grid->head[old]          = grid->next[i];
+            if (grid->next[i] >= 0) grid->prev[grid->next[i]] = grid->prev[i];
+        }
+
+        // Push to the front of the new one
+        grid->prev[i] = -1;
+        grid->next[i] = grid->head[c];
+        if (grid->head[c] >= 0) grid->prev[grid->head[c]] = i;
+        grid->head[c] = i;
+        grid->cell[i] = c;
+
+        moved++;
+    }
+    return moved;
+}
+
+static bool collide(AABBPack const* pack, int a, int b) {
+    return collision(
+        AABB { { pack->x[a], pack->y[a] }, { pack->w[a], pack->h[a] } },
+        AABB { { pack->x[b], pack->y[b] }, { pack->w[b], pack->h[b] } });
+}
+
+long grid_collisions(Grid const* grid, AABBPack const* pack, PairCallback callback, void* user) {
+    // Neighbours that come after a cell, so every pair of cells is visited once
+    constexpr int FORWARD[4][2] = { { 1, 0 }, { -1, 1 }, { 0, 1 }, { 1, 1 } };
+
+    long hits = 0;
+    for (int row = 0; row < grid->rows; row++) {
+        for (int col = 0; col < grid->cols; col++) {
+            int c = row * grid->cols + col;
+
+            for (int a = grid->head[c]; a >= 0; a = grid->next[a]) {
+                // The rest of the same cell
+                for (int b = grid->next[a]; b >= 0; b = grid->next[b]) {
+                    if (!collide(pack, a, b)) continue;
+                    hits++;
+                    if (callback) callback(a, b, user);
+                }
+
+                for (auto const& offset : FORWARD) {
+                    int ncol = col + offset[0];
+                    int nrow = row + offset[1];
+                    if (ncol < 0 || ncol >= grid->cols || nrow >= grid->rows) continue;
+
+                    for (int b = grid->head[nrow * grid->cols + ncol]; b >= 0; b = grid->next[b]) {
+                        if (!collide(pack, a, b)) continue;
+                        hits++;
+                        if (callback) callback(a, b, user);
+                    }
+                }
+            }
+        }
+    }
+    return hits;
+}
+
+int grid_query(Grid const* grid, AABBPack const* pack, AABB r, HitCallback callback, void* user) {
+    // Objects are at most a cell large, so the ones that reach into r
+    // have their corner at most a cell to the left or above of it
+    int col0 = cell_coord(r.pos.x - grid->cell_size,    grid->cell_size, grid->cols);
+    int col1 = cell_coord(r.pos.x + r.size.x,           grid->cell_size, grid->cols);
+    int row0 = cell_coord(r.pos.y - grid->cell_size,    grid->cell_size, grid->rows);
+    int row1 = cell_coord(r.pos.y + r.size.y,           grid->cell_size, grid->rows);
+
+    int hits = 0;
+    for (int row = row0; row <= row1; row++) {
+        for (int col = col0; col <= col1; col++) {
+            for (int i = grid->head[row * grid->cols + col]; i >= 0; i = grid->next[i]) {
+                if (!collision(r, AABB { { pack->x[i], pack->y[i] }, { pack->w[i], pack->h[i] } })) continue;
+                hits++;
+                if (callback) callback(i, user);
+            }
+        }
+    }
+    return hits;
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include "collision.h"
+
+constexpr int GRID_CELL = 16; // Default side of a grid cell in pixels
+
+/// Uniform grid over the field. An object lives in the cell of its top
+/// left corner, so as long as no object is larger than a cell, objects
+/// can only collide with objects of the same or a neighbouring cell.
+/// Objects outside of the field are kept in the border cells.
+struct Grid {
+    int cell_size;
+    int cols;
+    int rows;
+    int count;      // Objects tracked
+
+    int* head;      // First object of every cell, -1 if the cell is empty
+    int* next;      // Next object in the same cell, -1 for the last one
+    int* prev;      // Previous object in the same cell, -1 for the first one
+    int* cell;      // Cell of every object, -1 if not inserted yet
+};
+
+/**
+ * @param count Number of objects, the boxes of an AABBPack of that size
+ * @param cell_size Side of a cell, at least the size of the largest object
+ * @returns 0 on success
+ */
+int grid_init(Grid* grid, int count, int cell_size);
+void grid_free(Grid* grid);
+
+/**
+ * Bring the grid up to date with the boxes. Only the objects that moved
+ * to another cell since the last update are relinked.
+ * @returns Number of objects relinked
+ */
+int grid_update(Grid* grid, AABBPack const* pack);
+
+using PairCallback = void (*)(int a, int b, void* user);
+using HitCallback  = void (*)(int i, void* user);
+
+/**
+ * Run collision() on every candidate pair of neighbouring objects.
+ * @param callback Called with every colliding pair, may be null
+ * @returns Number of colliding pairs
+ */
+long grid_collisions(Grid const* grid, AABBPack const* pack, PairCallback callback, void* user);
+
+/**
+ * Find the objects colliding with a rectangle of any size.
+ * @param callback Called with every colliding object, may be null
+ * @returns Number of colliding objects
+ */
+int grid_query(Grid const* grid, AABBPack const* pack, AABB r, HitCallback callback, void* user);
@@ -1,5 +1,18 @@
 #include "collision.h"
 
+#include <stdlib.h>
+
+#include <glm/simd/platform.h>
+
+#if (GLM_ARCH & GLM_ARCH_X86_BIT) && defined(__SSE2__)
+#   define COLLISION_SSE2
+#   include <emmintrin.h>
+#   if GLM_COMPILER & (GLM_COMPILER_GCC | GLM_COMPILER_CLANG)
+#       define COLLISION_AVX2
+#       include <immintrin.h>
+#   endif
+#endif
+
 bool collision(AABB r1, AABB r2) {
     return
         (r1.pos.x <= r2.pos.x + r2.size.x
@@ -11,3 +24,150 @@ bool collision(AABB r1, AABB r2) {
          r2.pos.y <= r1.pos.y + r1.size.y);
 
 }
+
+int aabb_pack_init(AABBPack* pack, int count) {
+    // Whole cache lines, so the arrays are aligned for any vector width
+    size_t bytes = (count * sizeof(float) + 63) / 64 * 64;
+    if (!bytes) bytes = 64;
+
+    pack->count = count;
+    pack->x = (float*) aligned_alloc(64, bytes);
+    pack->y = (float*) aligned_alloc(64, bytes);
+    pack->w = (float*) aligned_alloc(64, bytes);
+    pack->h = (float*) aligned_alloc(64, bytes);
+
+    if (!pack->x || !pack->y || !pack->w || !pack->h) {
+        aabb_pack_free(pack);
+        return -1;
+    }
+    return 0;
+}
+
+void aabb_pack_free(AABBPack* pack) {
+    free(pack->x);
+    free(pack->y);
+    free(pack->w);
+    free(pack->h);
+    *pack = {0};
+}
+
+void aabb_pack_set(AABBPack* pack, int i, AABB r) {
+    pack->x[i] = r.pos.x;
+    pack->y[i] = r.pos.y;
+    pack->w[i] = r.size.x;
+    pack->h[i] = r.size.y;
+}
+
+// One against many kernels. Each handles [begin, count) and returns the
+// number of collisions. Same comparisons as collision(AABB, AABB).
+
+static int collision_scalar(AABB r, AABBPack const* pack, unsigned char* hits, int begin) {
+    int n = 0;
+    for (int i = begin; i < pack->count; i++) {
+        hits[i] =
+            (r.pos.x <= pack->x[i] + pack->w[i]) & (pack->x[i] <= r.pos.x + r.size.x)
+          & (r.pos.y <= pack->y[i] + pack->h[i]) & (pack->y[i] <= r.pos.y + r.size.y);
+        n += hits[i];
+    }
+    return n;
+}
+
+#ifdef COLLISION_SSE2
+static int collision_sse2(AABB r, AABBPack const* pack, unsigned char* hits) {
+    __m128 left     = _mm_set1_ps(r.pos.x);
+    __m128 right    = _mm_set1_ps(r.pos.x + r.size.x);
+    __m128 top      = _mm_set1_ps(r.pos.y);
+    __m128 bottom   = _mm_set1_ps(r.pos.y + r.size.y);
+
+    int n = 0;
+    int i = 0;
+    for (; i + 4 <= pack->count; i += 4) {
+        __m128 x = _mm_loadu_ps(pack->x + i);
+        __m128 y = _mm_loadu_ps(pack->y + i);
+        __m128 w = _mm_loadu_ps(pack->w + i);
+        __m128 h = _mm_loadu_ps(pack->h + i);
+
+        __m128 hit = _mm_and_ps(
+            _mm_and_ps(_mm_cmple_ps(left, _mm_add_ps(x, w)), _mm_cmple_ps(x, right)),
+            _mm_and_ps(_mm_cmple_ps(top,  _mm_add_ps(y, h)), _mm_cmple_ps(y, bottom)));
+
+        int mask = _mm_movemask_ps(hit);
+        for (int k = 0; k < 4; k++) hits[i + k] = (mask >> k) & 1;
+        n += __builtin_popcount(mask);
+    }
+    return n + collision_scalar(r, pack, hits, i);
+}
+#endif
+
+#ifdef COLLISION_AVX2
+__attribute__((target("avx2")))
+static int collision_avx2(AABB r, AABBPack const* pack, unsigned char* hits) {
+    __m256 left     = _mm256_set1_ps(r.pos.x);
+    __m256 right    = _mm256_set1_ps(r.pos.x + r.size.x);
+    __m256 top      = _mm256_set1_ps(r.pos.y);
+    __m256 bottom   = _mm256_set1_ps(r.pos.y + r.size.y);
+
+    int n = 0;
+    int i = 0;
+    for (; i + 8 <= pack->count; i += 8) {
+        __m256 x = _mm256_loadu_ps(pack->x + i);
+        __m256 y = _mm256_loadu_ps(pack->y + i);
+        __m256 w = _mm256_loadu_ps(pack->w + i);
+        __m256 h = _mm256_loadu_ps(pack->h + i);
+
+        __m256 hit = _mm256_and_ps(
+            _mm256_and_ps(
+                _mm256_cmp_ps(left, _mm256_add_ps(x, w), _CMP_LE_OQ),
+                _mm256_cmp_ps(x, right, _CMP_LE_OQ)),
+            _mm256_and_ps(
+                _mm256_cmp_ps(top, _mm256_add_ps(y, h), _CMP_LE_OQ),
+                _mm256_cmp_ps(y, bottom, _CMP_LE_OQ)));
+
+        int mask = _mm256_movemask_ps(hit);
+        for (int k = 0; k < 8; k++) hits[i + k] = (mask >> k) & 1;
+        n += __builtin_popcount(mask);
+    }
+    return n + collision_scalar(r, pack, hits, i);
+}
+#endif
+
+static int collision_fallback(AABB r, AABBPack const* pack, unsigned char* hits) {
+    return collision_scalar(r, pack, hits, 0);
+}
+
+using CollisionKernel = int (*)(AABB, AABBPack const*, unsigned char*);
+
+/// The widest kernel the CPU runs
+static CollisionKernel pick_kernel() {
+#ifdef COLLISION_AVX2
+    if (__builtin_cpu_supports("avx2")) return collision_avx2;
+#endif
+#ifdef COLLISION_SSE2
+    return collision_sse2;
+#else
+    return collision_fallback;
+#endif
+}
+
+int collision(AABB r, AABBPack const* pack, unsigned char* hits) {
+    static CollisionKernel const kernel = pick_kernel();
+    return kernel(r, pack, hits);
+}
+
+int collision_on(CollisionPath path, AABB r, AABBPack const* pack, unsigned char* hits) {
+    switch (path) {
+        case COLLISION_PATH_SCALAR:
+            return collision_fallback(r, pack, hits);
+#ifdef COLLISION_SSE2
+        case COLLISION_PATH_SSE2:
+            return collision_sse2(r, pack, hits);
+#endif
+#ifdef COLLISION_AVX2
+        case COLLISION_PATH_AVX2:
+            if (__builtin_cpu_supports("avx2")) return collision_avx2(r, pack, hits);
+            return -1;
+#endif
+        default:
+            return -1;
+    }
+}
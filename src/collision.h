@@ -1,5 +1,7 @@
 #pragma once
 
+#include <math.h>
+
 #include <glm/vec2.hpp>
 
 struct AABB {
@@ -13,3 +15,77 @@ struct AABB {
  * @returns Whether or not they collide
  */
 bool collision(AABB r1, AABB r2);
+
+/**
+ * Find when a moving rectangle first touches a still one. Rectangles
+ * that already overlap at the start don't collide, so a rectangle that
+ * bounced off at the contact can leave.
+ * Inline and free of branches, so batched loops can vectorize it.
+ * @param r Moving rectangle at the start of the motion
+ * @param d Displacement of r over the whole motion
+ * @param target Still rectangle
+ * @param xaxis Receives 1 if the contact is on a vertical side of the target
+ * @returns Fraction of d travelled at the contact, greater than 1 if they don't collide
+ */
+inline float sweep(AABB r, glm::vec2 d, AABB target, int* xaxis) {
+    // Distances to the sides where the overlap starts and where it ends
+    float x_near = d.x > 0 ? target.pos.x - (r.pos.x + r.size.x) : target.pos.x + target.size.x - r.pos.x;
+    float x_far  = d.x > 0 ? target.pos.x + target.size.x - r.pos.x : target.pos.x - (r.pos.x + r.size.x);
+    float y_near = d.y > 0 ? target.pos.y - (r.pos.y + r.size.y) : target.pos.y + target.size.y - r.pos.y;
+    float y_far  = d.y > 0 ? target.pos.y + target.size.y - r.pos.y : target.pos.y - (r.pos.y + r.size.y);
+
+    // Not moving along an axis means overlapping on it either always or never
+    int x_overlap = (r.pos.x <= target.pos.x + target.size.x) & (target.pos.x <= r.pos.x + r.size.x);
+    int y_overlap = (r.pos.y <= target.pos.y + target.size.y) & (target.pos.y <= r.pos.y + r.size.y);
+
+    float x_entry = d.x == 0 ? (x_overlap ? -INFINITY :  INFINITY) : x_near / d.x;
+    float x_exit  = d.x == 0 ? (x_overlap ?  INFINITY : -INFINITY) : x_far  / d.x;
+    float y_entry = d.y == 0 ? (y_overlap ? -INFINITY :  INFINITY) : y_near / d.y;
+    float y_exit  = d.y == 0 ? (y_overlap ?  INFINITY : -INFINITY) : y_far  / d.y;
+
+    // Overlapping on both axes at once
+    float entry = x_entry > y_entry ? x_entry : y_entry;
+    float exit  = x_exit  < y_exit  ? x_exit  : y_exit;
+
+    *xaxis = x_entry >= y_entry;
+    int hit = (entry <= exit) & (entry >= 0);
+    return hit ? entry : 2.0f;
+}
+
+/// Boxes packed as a struct of arrays for the batched tests
+struct AABBPack {
+    int    count;
+    float* x;
+    float* y;
+    float* w;
+    float* h;
+};
+
+/// Allocate the arrays for count boxes
+/// @returns 0 on success
+int aabb_pack_init(AABBPack* pack, int count);
+void aabb_pack_free(AABBPack* pack);
+void aabb_pack_set(AABBPack* pack, int i, AABB r);
+
+/**
+ * Check one rectangle against every rectangle of the pack. Uses AVX2 or
+ * SSE2 when the CPU has them, picked at runtime.
+ * @param hits Receives pack->count flags, 1 for every colliding rectangle
+ * @returns Number of collisions
+ */
+int collision(AABB r, AABBPack const* pack, unsigned char* hits);
+
+/// Code paths collision(AABB, AABBPack const*, unsigned char*) picks from
+enum CollisionPath {
+    COLLISION_PATH_SCALAR,
+    COLLISION_PATH_SSE2,
+    COLLISION_PATH_AVX2,
+    COLLISION_PATHS
+};
+
+/**
+ * Like collision(r, pack, hits), on the given path, so the paths can be
+ * checked against each other.
+ * @returns Number of collisions, -1 if the path isn't built in or the CPU lacks it
+ */
+int collision_on(CollisionPath path, AABB r, AABBPack const* pack, unsigned char* hits);
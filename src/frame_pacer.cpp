@@ -0,0 +1,103 @@
+#include "frame_pacer.h"
+
+#include <math.h>
+#include <string.h>
+#include <time.h>
+
+#include "setup_opengl.h"
+
+static char const* const PACE_NAMES[PACE_MODES] = { "uncapped", "vsync", "adaptive", "jit" };
+
+int pace_mode(char const* name) {
+    for (int mode = 0; mode < PACE_MODES; mode++) {
+        if (!strcmp(name, PACE_NAMES[mode])) return mode;
+    }
+    return -1;
+}
+
+void frame_pacer_init(FramePacer* pacer, PaceMode mode, int refresh_rate) {
+    *pacer = {};
+    pacer->period = 1.0 / refresh_rate;
+    pacer->margin = PACE_MARGIN_MIN;
+
+    if (mode == PACE_ADAPTIVE && !glfwExtensionSupported("GLX_EXT_swap_control_tear")
+                              && !glfwExtensionSupported("WGL_EXT_swap_control_tear")) {
+        fputs("ERROR:PACING:adaptive vsync not supported, using vsync\n", stderr);
+        mode = PACE_VSYNC;
+    }
+    pacer->mode = mode;
+
+    int interval = mode == PACE_UNCAPPED ? 0 : mode == PACE_ADAPTIVE ? -1 : 1;
+    glfwSwapInterval(interval);
+}
+
+static void sleep_for(double seconds) {
+    if (seconds <= 0) return;
+    timespec ts = { (time_t) seconds, (long) ((seconds - (time_t) seconds) * 1e9) };
+    nanosleep(&ts, nullptr);
+}
+
+/// Most a frame cost lately, frames rarely get slower than that all at once
+static double predicted_cost(FramePacer const* pacer) {
+    int count = pacer->frames < PACE_HISTORY ? pacer->frames : PACE_HISTORY;
+    double cost = 0;
+    for (int i = 0; i < count; i++) {
+        if (pacer->costs[i] > cost) cost = pacer->costs[i];
+    }
+    return cost;
+}
+
+void frame_pacer_wait(FramePacer* pacer) {
+    double now = glfwGetTime();
+    if (pacer->mode != PACE_JIT || !pacer->swapped) {
+        pacer->woke = now;
+        return;
+    }
+
+    // The first blank there is still time to render for, in phase with the last one shown
+    double lead     = predicted_cost(pacer) + pacer->margin;
+    double blanks   = ceil((now + lead - pacer->swapped) / pacer->period);
+    pacer->target   = pacer->swapped + (blanks > 1 ? blanks : 1) * pacer->period;
+
+    // Keys are stamped by the main thread meanwhile, the sleep holds up nothing
+    sleep_for(pacer->target - lead - now);
+    pacer->woke = glfwGetTime();
+}
+
+void frame_pacer_idle(FramePacer* pacer, double timeout) {
+    // Just in time, the next wait sleeps until a blank anyway
+    if (pacer->mode != PACE_JIT) sleep_for(timeout);
+}
+
+void frame_pacer_submitted(FramePacer* pacer) {
+    if (pacer->mode != PACE_JIT) return;
+
+    glFinish();
+    pacer->costs[pacer->frames % PACE_HISTORY] = glfwGetTime() - pacer->woke;
+    pacer->frames++;
+}
+
+void frame_pacer_swapped(FramePacer* pacer) {
+    if (pacer->mode != PACE_JIT) return;
+
+    // The swap may only be queued, the finish waits for the flip
+    glFinish();
+    double now = glfwGetTime();
+
+    if (pacer->swapped && now > pacer->target + pacer->period / 2) {
+        pacer->late++;
+        pacer->margin = fmin(pacer->margin * 2, pacer->period / 2);
+    } else {
+        pacer->margin = fmax(pacer->margin * 0.98, PACE_MARGIN_MIN);
+    }
+    pacer->swapped = now;
+}
+
+void frame_pacer_report(FramePacer const* pacer, FILE* out) {
+    fprintf(out, "Pacing: %s", PACE_NAMES[pacer->mode]);
+    if (pacer->mode == PACE_JIT) {
+        fprintf(out, ", %ld of %d frames late, cost %.2f ms, margin %.2f ms",
+                pacer->late, pacer->frames, predicted_cost(pacer) * 1e3, pacer->margin * 1e3);
+    }
+    fputc('\n', out);
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <stdio.h>
+
+enum PaceMode {
+    PACE_UNCAPPED,  // Swap right away and start over, tears and burns a core
+    PACE_VSYNC,     // Swaps wait for the vertical blank
+    PACE_ADAPTIVE,  // Like vsync, a late swap tears instead of waiting a whole refresh
+    PACE_JIT,       // Vsync, but sleep until just before the deadline, then render
+    PACE_MODES
+};
+
+constexpr int    PACE_HISTORY    = 32;      // Frames the cost is predicted from
+constexpr double PACE_MARGIN_MIN = 0.001;   // Seconds a just-in-time frame keeps in hand at least
+
+/// When a frame starts, so the state it shows is sampled as late as the
+/// display allows. Just in time, the frame sleeps until the next blank
+/// minus the most a frame cost lately and a margin, the margin doubles
+/// when a frame misses its blank and shrinks back while none do.
+struct FramePacer {
+    PaceMode mode;
+    double   period;                // Seconds between blanks
+    double   costs[PACE_HISTORY];   // Seconds from waking to the GPU being done
+    int      frames;                // Ever measured
+    double   margin;
+    double   woke;                  // When the current frame started
+    double   target;                // Blank it should make
+    double   swapped;               // When the last one was shown
+    long     late;                  // Frames that missed their blank
+};
+
+/// @returns The mode called name, like "jit", or -1 if there is none
+int pace_mode(char const* name);
+
+/**
+ * Set the swap interval of the current context for mode. Adaptive falls
+ * back to vsync without the swap_control_tear extension.
+ * @param refresh_rate Of the monitor, in Hz
+ */
+void frame_pacer_init(FramePacer* pacer, PaceMode mode, int refresh_rate);
+
+/// Just in time, sleep until the deadline of the next frame
+void frame_pacer_wait(FramePacer* pacer);
+
+/// Nothing to draw, sleep timeout seconds before looking again
+void frame_pacer_idle(FramePacer* pacer, double timeout);
+
+/// The frame is submitted, just in time, wait for the GPU and measure its cost
+void frame_pacer_submitted(FramePacer* pacer);
+
+/// The swap returned, just in time, wait for the blank and check if it was made
+void frame_pacer_swapped(FramePacer* pacer);
+
+void frame_pacer_report(FramePacer const* pacer, FILE* out);
@@ -0,0 +1,114 @@
+#include "frame_stats.h"
+
+#include <algorithm>
+
+static glm::vec3 const BAR_COLOR     = { 0.3f, 0.8f, 0.3f };
+static glm::vec3 const STUTTER_COLOR = { 0.9f, 0.2f, 0.2f };
+static glm::vec3 const LINE_COLOR    = { 0.9f, 0.9f, 0.2f };
+
+constexpr float OVERLAY_PX_PER_MS = 3.0f;
+constexpr float OVERLAY_MAX_H     = 100.0f;  // Longer frames are cut off
+constexpr float OVERLAY_BAR_W     = 2.0f;
+
+void frame_stats_init(FrameStats* stats, double stutter_ms) {
+    *stats = {0};
+    stats->stutter_ms = stutter_ms;
+}
+
+void frame_stats_add(FrameStats* stats, double seconds) {
+    double ms = seconds * 1e3;
+    stats->deltas[stats->frames % FRAME_STATS_RING] = ms;
+    stats->frames++;
+    stats->stutters += ms > stats->stutter_ms;
+    if (ms > stats->max_ms) stats->max_ms = ms;
+}
+
+void frame_stats_summary(FrameStats const* stats, FrameSummary* summary) {
+    *summary = {0};
+    summary->max_ms   = stats->max_ms;
+    summary->stutters = stats->stutters;
+
+    long count = std::min<long>(stats->frames, FRAME_STATS_RING);
+    summary->frames = count;
+    if (!count) return;
+
+    double sorted[FRAME_STATS_RING];
+    double sum = 0;
+    for (long i = 0; i < count; i++) {
+        double ms = stats->deltas[i];
+        sorted[i] = ms;
+        sum += ms;
+
+        int bin = (int) (ms / FRAME_BIN_MS);
+        summary->histogram[std::min(bin, FRAME_BINS - 1)]++;
+    }
+    std::sort(sorted, sorted + count);
+
+    summary->mean_ms = sum / count;
+    summary->p50_ms  = sorted[count * 50 / 100];
+    summary->p95_ms  = sorted[count * 95 / 100];
+    summary->p99_ms  = sorted[count * 99 / 100];
+}
+
+void frame_stats_report(FrameStats const* stats, FILE* out) {
+    FrameSummary s;
+    frame_stats_summary(stats, &s);
+
+    fprintf(out, "%ld frames, last %ld: mean %.2f ms, p50 %.2f, p95 %.2f, p99 %.2f, max %.2f\n",
+            stats->frames, s.frames, s.mean_ms, s.p50_ms, s.p95_ms, s.p99_ms, s.max_ms);
+    fprintf(out, "%ld stutters over %.2f ms\n", s.stutters, stats->stutter_ms);
+
+    long most = *std::max_element(s.histogram, s.histogram + FRAME_BINS);
+    for (int bin = 0; bin < FRAME_BINS && most; bin++) {
+        if (!s.histogram[bin]) continue;
+        if (bin < FRAME_BINS - 1)   fprintf(out, "%5.1f-%5.1f ms %7ld ", bin * FRAME_BIN_MS, (bin + 1) * FRAME_BIN_MS, s.histogram[bin]);
+        else                        fprintf(out, "%5.1f-      ms %7ld ", bin * FRAME_BIN_MS, s.histogram[bin]);
+
+        int width = (int) (s.histogram[bin] * 50 / most);
+        for (int i = 0; i < width; i++) fputc('#', out);
+        fputc('\n', out);
+    }
+}
+
+int frame_stats_write_csv(FrameStats const* stats, char const* path) {
+    FILE* out = fopen(path, "w");
+    if (!out) {
+        fprintf(stderr, "ERROR:FRAME_STATS:OPEN %s\n", path);
+        return -1;
+    }
+
+    fputs("frame,ms,stutter\n", out);
+    long first = stats->frames > FRAME_STATS_RING ? stats->frames - FRAME_STATS_RING : 0;
+    for (long frame = first; frame < stats->frames; frame++) {
+        double ms = stats->deltas[frame % FRAME_STATS_RING];
+        fprintf(out, "%ld,%.4f,%d\n", frame, ms, ms > stats->stutter_ms);
+    }
+
+    if (fclose(out)) {
+        fprintf(stderr, "ERROR:FRAME_STATS:WRITE %s\n", path);
+        return -1;
+    }
+    return 0;
+}
+
+int gen_overlay(FrameStats const* stats, Instance* instances) {
+    int count = 0;
+    long bars = std::min<long>(stats->frames, OVERLAY_FRAMES);
+
+    // y grows up, the bars stand on the bottom edge
+    for (long i = 0; i < bars; i++) {
+        long frame = stats->frames - bars + i;
+        double ms  = stats->deltas[frame % FRAME_STATS_RING];
+        float h    = std::min((float) ms * OVERLAY_PX_PER_MS, OVERLAY_MAX_H);
+
+        instances[count++] = {
+            { PADDING + i * OVERLAY_BAR_W, PADDING },
+            { OVERLAY_BAR_W, h },
+            ms > stats->stutter_ms ? STUTTER_COLOR : BAR_COLOR,
+        };
+    }
+
+    float line = std::min((float) stats->stutter_ms * OVERLAY_PX_PER_MS, OVERLAY_MAX_H);
+    instances[count++] = { { PADDING, PADDING + line }, { OVERLAY_FRAMES * OVERLAY_BAR_W, 1.0f }, LINE_COLOR };
+    return count;
+}
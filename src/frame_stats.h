@@ -0,0 +1,55 @@
+#pragma once
+
+#include <stdio.h>
+
+#include "renderer.h"
+
+constexpr int    FRAME_STATS_RING = 4096;   // Frames the percentiles are taken over
+constexpr int    FRAME_BINS       = 17;     // Histogram bins
+constexpr double FRAME_BIN_MS     = 2.0;    // Width of a bin, the last one takes everything longer
+constexpr int    OVERLAY_FRAMES   = 120;    // Bars in the overlay, one per frame
+
+/// Time between the frames shown, the latest FRAME_STATS_RING of them
+struct FrameStats {
+    double  deltas[FRAME_STATS_RING];   // Milliseconds
+    long    frames;                     // Ever recorded
+    double  stutter_ms;                 // Frames longer than this are stutters
+    long    stutters;                   // Ever counted
+    double  max_ms;                     // Ever seen
+};
+
+struct FrameSummary {
+    long    frames;     // In the percentiles, up to FRAME_STATS_RING
+    double  mean_ms;
+    double  p50_ms;
+    double  p95_ms;
+    double  p99_ms;
+    double  max_ms;
+    long    stutters;
+    long    histogram[FRAME_BINS];
+};
+
+/// @param stutter_ms Frames longer than this count as stutters
+void frame_stats_init(FrameStats* stats, double stutter_ms);
+
+void frame_stats_add(FrameStats* stats, double seconds);
+
+/// Percentiles and histogram of the frames in the ring. Max and
+/// stutters cover the whole run.
+void frame_stats_summary(FrameStats const* stats, FrameSummary* summary);
+
+/// Print the summary with the histogram
+void frame_stats_report(FrameStats const* stats, FILE* out);
+
+/**
+ * One line per frame in the ring, oldest first: frame,ms,stutter
+ * @returns 0 on success
+ */
+int frame_stats_write_csv(FrameStats const* stats, char const* path);
+
+/**
+ * Bars of the latest OVERLAY_FRAMES frame times in the bottom left
+ * corner, red for stutters, with a line at the stutter threshold.
+ * @returns Instances written, at most OVERLAY_FRAMES + 1
+ */
+int gen_overlay(FrameStats const* stats, Instance* instances);
@@ -0,0 +1,183 @@
+#include "game.h"
+
+#include <math.h>
+
+#include "util/profiler.h"
+
+bool update_paddles(Input INPUT, Game* game, float delta_time) {
+    PROFILE_ZONE("update_paddles");
+
+    int& lpp = game->lpad;
+    int& rpp = game->rpad;
+
+    float ldisplacement = (INPUT.ldir) * PADSPEED;
+    float rdisplacement = (INPUT.rdir) * PADSPEED;
+
+    float flr_dis = ldisplacement * delta_time + game->remainder_l; // Real left displacement
+    float frr_dis = rdisplacement * delta_time + game->remainder_r; // Real right displacement
+
+    int lr_dis = floor(flr_dis);
+    int rr_dis = floor(frr_dis);
+
+    game->remainder_r = frr_dis - rr_dis;
+    game->remainder_l = flr_dis - lr_dis;
+                          // + 5 for bias                             // + 5 for the same reason
+    lr_dis *= !(lpp + lr_dis + 5 < 0 || lpp + lr_dis > HEIGHT - PADDLE_H + 5);    // Don't get out of the screen
+    rr_dis *= !(rpp + rr_dis + 5 < 0 || rpp + rr_dis > HEIGHT - PADDLE_H + 5);    // Don't get out of the screen
+
+    lpp += lr_dis;
+    rpp += rr_dis;
+
+    return (lr_dis != 0 || rr_dis != 0);
+}
+
+void update_ball(Ball* ball, int lpad, int rpad, float delta_time) {
+    PROFILE_ZONE("update_ball");
+    move_ball(ball->pos.x, ball->pos.y, ball->vel.x, ball->vel.y, lpad, rpad, delta_time);
+}
+
+void reset(Game* game) {
+    game->lpad = (HEIGHT - PADDLE_H) >> 1;
+    game->rpad = game->lpad;
+
+    game->remainder_l = 0;
+    game->remainder_r = 0;
+
+    game->ball.pos.x = (float) ((WIDTH  - BALL_W) >> 1);
+    game->ball.pos.y = (float) ((HEIGHT - BALL_H) >> 1);
+    // Reset the velocity of a ball
+    game->ball.vel = glm::vec2(-1.0f) * BALL_SPEED;
+}
+
+bool step(Game* game, Input INPUT, float delta_time) {
+    if (INPUT.should_restart) reset(game);
+
+    bool moved = update_paddles(INPUT, game, delta_time);
+    update_ball(&game->ball, game->lpad, game->rpad, delta_time);
+    return moved;
+}
+
+void fixed_step_init(FixedStep* clock, int tick_rate) {
+    clock->tick         = 1.0 / tick_rate;
+    clock->delta_time   = (float) clock->tick;
+    clock->accumulator  = 0;
+    clock->ticks        = 0;
+    clock->time         = 0;
+    clock->frequency    = 1;
+}
+
+void fixed_step_start(FixedStep* clock, uint64_t now, uint64_t frequency) {
+    clock->time      = now;
+    clock->frequency = frequency;
+}
+
+/// Fold an event into the input
+static void apply_event(InputStream* stream, InputEvent event) {
+    unsigned char bit = 1 << event.code;
+    if (event.pressed)  stream->held |= bit;
+    else                stream->held &= ~bit;
+
+    Input& input = stream->input;
+    if (event.pressed && event.code == RESTART) input.should_restart = 1;
+    if (event.pressed && event.code == PAUSE)   input.pause = !input.pause;
+
+    unsigned char held = stream->held;
+    input.ldir = held & (1 << LEFT_PADDLE_DOWN)  ? -1 : held & (1 << LEFT_PADDLE_UP)  ? 1 : 0;
+    input.rdir = held & (1 << RIGHT_PADDLE_DOWN) ? -1 : held & (1 << RIGHT_PADDLE_UP) ? 1 : 0;
+}
+
+/// Apply the events up to time. Stops at a release of a key pressed
+/// since the call, the tick has to see the press first.
+static void take_events(InputStream* stream, uint64_t time) {
+    unsigned char pressed = 0;
+    InputEvent event;
+    while (input_queue_peek(stream->queue, &event) && event.time <= time) {
+        unsigned char bit = 1 << event.code;
+        if (!event.pressed && (pressed & bit)) break;
+        if (event.pressed) pressed |= bit;
+
+        apply_event(stream, event);
+        input_queue_pop(stream->queue);
+        if (stream->taken_count < INPUT_TAKEN) stream->taken[stream->taken_count++] = event;
+    }
+}
+
+void run_tick(Game* prev, Game* curr, Input* input, float delta_time) {
+    *prev = *curr;
+
+    // Restart and don't interpolate from the old match
+    if (input->should_restart) {
+        reset(curr);
+        *prev = *curr;
+        input->should_restart = 0;
+    }
+    step(curr, *input, delta_time);
+}
+
+int advance(FixedStep* clock, Game* prev, Game* curr, InputStream* stream, uint64_t now) {
+    double frame_time = (double) (now - clock->time) / clock->frequency;
+    clock->time = now;
+    stream->taken_count = 0;
+
+    if (stream->input.pause) {
+        // Hold still, not even interpolating, only look for the unpause
+        take_events(stream, now);
+        *prev = *curr;
+        clock->accumulator = 0;
+        return 0;
+    }
+
+    // Don't try to catch up after a long hitch, it only makes the next frame longer
+    if (frame_time > MAX_FRAME_TIME) frame_time = MAX_FRAME_TIME;
+    clock->accumulator += frame_time;
+
+    int ran = 0;
+    while (clock->accumulator >= clock->tick && !stream->input.pause) {
+        // Real time the tick ends at
+        double ahead  = clock->accumulator - clock->tick;
+        uint64_t end  = now - (uint64_t) (ahead * clock->frequency);
+        take_events(stream, end);
+        if (stream->input.pause) break;
+
+        if (stream->on_tick) stream->on_tick(stream->user, curr, stream->input);
+        run_tick(prev, curr, &stream->input, clock->delta_time);
+
+        clock->accumulator -= clock->tick;
+        clock->ticks++;
+        ran++;
+    }
+    return ran;
+}
+
+float fixed_step_alpha(FixedStep const* clock) {
+    return (float) (clock->accumulator / clock->tick);
+}
+
+RenderState interpolate(Game const* prev, Game const* curr, float alpha) {
+    RenderState state;
+    state.lpad = prev->lpad + (curr->lpad - prev->lpad) * alpha;
+    state.rpad = prev->rpad + (curr->rpad - prev->rpad) * alpha;
+    state.ball = prev->ball.pos + (curr->ball.pos - prev->ball.pos) * alpha;
+    return state;
+}
+
+/// Direction that brings the paddle center towards y
+static int follow(int pad, float y) {
+    float center = pad + PADDLE_H * 0.5f;
+    if (y > center + PADDLE_H * 0.25f) return  1;
+    if (y < center - PADDLE_H * 0.25f) return -1;
+    return 0;
+}
+
+bool scored(Game const* game) {
+    return game->ball.pos.x + BALL_W < 0 || game->ball.pos.x > WIDTH;
+}
+
+Input bot_input(Game const* game) {
+    float y = game->ball.pos.y + BALL_H * 0.5f;
+
+    Input input = {0};
+    input.ldir = follow(game->lpad, y);
+    input.rdir = follow(game->rpad, y);
+    return input;
+}
@@ -0,0 +1,210 @@
+#pragma once
+
+#include <stdint.h>
+
+#include <glm/vec2.hpp>
+
+#include "collision.h"
+#include "input_queue.h"
+
+/// Field properties. The window is exactly the size of the field.
+constexpr int WIDTH         = 800;
+constexpr int HEIGHT        = 450;
+
+constexpr int PADDLE_W = 10; // Width of the paddle in pixels
+constexpr int PADDLE_H = 50; // Height of the paddle in pixels
+
+constexpr int BALL_W        = 10;
+constexpr int BALL_H        = 10;
+constexpr float BALL_SPEED  = 10.0f;
+constexpr float SPEED_MOD   = 1.2f;
+
+constexpr int PADDING = 30;  // Distance from the edge of the screen in pixels
+
+constexpr float PADSPEED = 30.0f;
+
+constexpr int MAX_BOUNCES = 2; // Paddle contacts resolved within one update
+
+constexpr int    TICK_RATE      = 120;   // Default simulation rate in ticks per second
+constexpr double MAX_FRAME_TIME = 0.25;  // Longest frame the simulation catches up on, in seconds
+
+struct Input {
+    // Left pad
+    int ldir;
+    // Right pad
+    int rdir;
+
+    int should_restart;
+
+    int pause;
+};
+
+struct Ball {
+    glm::vec2 pos;
+    glm::vec2 vel;
+};
+
+/// The whole state of a single match. Has no dependency on the window
+/// or OpenGL, so it can be stepped headless.
+struct Game {
+    int lpad;   // Position of the top left pixel of the left paddle
+    int rpad;   // Position of the top left pixel of the right paddle
+
+    float remainder_l; // Sub-pixel displacement of the left paddle carried to the next update
+    float remainder_r; // Sub-pixel displacement of the right paddle carried to the next update
+
+    Ball ball;
+};
+
+/**
+ * Update the paddles according to the current input.
+ * @param game Match whose paddles are moved
+ * @param delta_time Time between two last updates
+ * @returns If any displacement is present
+ */
+bool update_paddles(Input INPUT, Game* game, float delta_time);
+
+/**
+ * Move the ball and bounce it off the paddles and the walls. Paddle
+ * contacts are found with a swept test, so a fast ball or a long update
+ * can't pass through a paddle.
+ * @param lpad Left paddle position vertically
+ * @param rpad Right paddle position vertically
+ */
+void update_ball(Ball* ball, int lpad, int rpad, float delta_time);
+
+/// Set the positions of all the objects to the default ones
+void reset(Game* game);
+
+/**
+ * Advance the match by one update.
+ * @returns If any paddle displacement is present
+ */
+bool step(Game* game, Input INPUT, float delta_time);
+
+/// Input of a trivial bot that keeps both paddles in line with the ball
+Input bot_input(Game const* game);
+
+/// The ball left the field past a paddle, the match should restart
+bool scored(Game const* game);
+
+/// Accumulator driven fixed-step clock. Every tick advances the
+/// simulation by exactly the same delta time, so a match only depends
+/// on its input and not on the frame rate.
+struct FixedStep {
+    double   tick;          // Duration of a tick in seconds
+    float    delta_time;    // The same duration as passed to step()
+    double   accumulator;   // Real time not simulated yet
+    uint64_t ticks;         // Ticks simulated since the start
+    uint64_t time;          // Timer value advance() was last called with
+    uint64_t frequency;     // Timer values in a second
+};
+
+/// Positions of the objects as they should be drawn
+struct RenderState {
+    float lpad;
+    float rpad;
+    glm::vec2 ball;
+};
+
+constexpr int INPUT_TAKEN = 32; // Events advance() lists as taken, more are applied but not listed
+
+/// Called before every tick with the state it starts from and the input it runs with
+typedef void (*TickCallback)(void* user, Game const* game, Input input);
+
+/// Timestamped input events and the input they add up to so far
+struct InputStream {
+    InputQueue*   queue;
+    unsigned char held;     // Bit per InputCode of the keys down
+    Input         input;
+
+    InputEvent    taken[INPUT_TAKEN];   // Events the last advance() applied, for latency tracking
+    int           taken_count;
+
+    TickCallback  on_tick;  // Optional, like a replay recorder
+    void*         user;
+};
+
+/// @param tick_rate Ticks per second
+void fixed_step_init(FixedStep* clock, int tick_rate);
+
+/**
+ * Start the real time clock advance() follows.
+ * @param now Timer value, like glfwGetTimerValue()
+ * @param frequency Timer values in a second
+ */
+void fixed_step_start(FixedStep* clock, uint64_t now, uint64_t frequency);
+
+/**
+ * Run as many ticks as fit into the real time elapsed until now. Every
+ * tick first takes the input events stamped before it ends, so input
+ * lands on the tick of its stamp, whatever the frame rate. Events are
+ * stamped when the event loop delivers them, not when the key went
+ * down, so that is only as precise as the loop polls. A
+ * release waits for the next tick if its press came in the same one,
+ * so even the shortest tap moves a paddle. Nothing runs while paused.
+ * @param prev Receives the state before the last tick
+ * @param curr State being advanced
+ * @param now Timer value of this frame
+ * @returns Ticks run
+ */
+int advance(FixedStep* clock, Game* prev, Game* curr, InputStream* input, uint64_t now);
+
+/**
+ * One tick the way advance() runs it: restart if asked, then step.
+ * Replaying the inputs of the ticks reproduces a match exactly.
+ * @param prev Receives the state before the tick, or the restarted one
+ * @param input Its should_restart is cleared
+ */
+void run_tick(Game* prev, Game* curr, Input* input, float delta_time);
+
+/// How far the real time is between prev and curr, in [0, 1)
+float fixed_step_alpha(FixedStep const* clock);
+
+RenderState interpolate(Game const* prev, Game const* curr, float alpha);
+
+/**
+ * The body of update_ball() on plain floats. Inline and free of branches
+ * so MatchBatch steps its balls with the very same arithmetic.
+ */
+inline void move_ball(float& x, float& y, float& vx, float& vy, int lpad, int rpad, float delta_time) {
+    AABB lpaddle_aabb   = { { PADDING, lpad }, {PADDLE_W, PADDLE_H} };
+    AABB rpaddle_aabb   = { { WIDTH - PADDING - PADDLE_W, rpad }, {PADDLE_W, PADDLE_H} };
+
+    float time = delta_time; // Time left to move
+    #pragma GCC unroll 2 // MAX_BOUNCES, an unrolled loop can be vectorized
+    for (int bounce = 0; bounce < MAX_BOUNCES; bounce++) {
+        AABB ball_aabb  = { { x, y }, { BALL_W, BALL_H } };
+        glm::vec2 d     = { vx * time, vy * time };
+
+        int lxaxis, rxaxis;
+        float tl = sweep(ball_aabb, d, lpaddle_aabb, &lxaxis);
+        float tr = sweep(ball_aabb, d, rpaddle_aabb, &rxaxis);
+
+        // Move up to the first contact, or all the way
+        int left    = tl <= tr;
+        float t     = left ? tl : tr;
+        int hit     = t <= 1.0f;
+        t = hit ? t : 1.0f;
+
+        x += d.x * t;
+        y += d.y * t;
+        time -= time * t;
+
+        int lhit    = hit &  left &  lxaxis;
+        int rhit    = hit & !left &  rxaxis;
+        int edge    = hit & ((left & !lxaxis) | (!left & !rxaxis)); // Top or bottom of a paddle
+
+        // Left paddle flips and doubles the velocity
+        vx = lhit ? -vx + -vx : vx;
+        vy = lhit ?  vy +  vy : vy;
+        // Right paddle flips and speeds up
+        vx = rhit ? SPEED_MOD * -vx : vx;
+        vy = edge ? -vy : vy;
+    }
+
+    // Ceiling or floor. Only flip towards the field, a ball that went far
+    // past the wall on a long update must not flip back and forth.
+    int wall = ((y < 0) & (vy < 0)) | ((y + BALL_H > HEIGHT) & (vy > 0));
+    vy = wall ? -vy : vy;
+}
@@ -0,0 +1,109 @@
+#include "gpu_timer.h"
+
+#include <string.h>
+#include <time.h>
+
+static char const* const PASS_NAMES[GPU_PASSES] = { "gpu_clear", "gpu_draw", "gpu_swap" };
+
+static uint64_t clock_ns() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+int gpu_timer_init(GpuTimer* timer, bool enabled) {
+    memset(timer, 0, sizeof(*timer));
+    timer->slot = -1;
+    if (!enabled) return 0;
+
+    // Core since 3.3, still missing on some old contexts
+    if (!GLEW_ARB_timer_query) {
+        fputs("ERROR:GPU_TIMER:NO_TIMER_QUERY\n", stderr);
+        return -1;
+    }
+
+    glGenQueries(GPU_TIMER_FRAMES * GPU_PASSES * 2, &timer->queries[0][0][0]);
+    timer->track   = profiler_track("GPU");
+    timer->enabled = true;
+    return 0;
+}
+
+void gpu_timer_free(GpuTimer* timer) {
+    if (timer->enabled) glDeleteQueries(GPU_TIMER_FRAMES * GPU_PASSES * 2, &timer->queries[0][0][0]);
+    memset(timer, 0, sizeof(*timer));
+}
+
+/// Read the timestamps of a finished frame into the profiler
+static void collect(GpuTimer* timer, int slot) {
+    // Where the GPU clock is on the CPU one, taken anew every time as
+    // the two drift apart
+    GLint64 gpu_now;
+    glGetInteger64v(GL_TIMESTAMP, &gpu_now);
+    int64_t offset = (int64_t) clock_ns() - gpu_now;
+
+    for (int pass = 0; pass < GPU_PASSES; pass++) {
+        if (!timer->timed[slot][pass]) continue;
+        timer->timed[slot][pass] = false;
+
+        GLuint64 start, end;
+        glGetQueryObjectui64v(timer->queries[slot][pass][0], GL_QUERY_RESULT, &start);
+        glGetQueryObjectui64v(timer->queries[slot][pass][1], GL_QUERY_RESULT, &end);
+
+        timer->ms[pass] = (end - start) * 1e-6;
+        timer->total_ms[pass] += timer->ms[pass];
+        timer->samples[pass]++;
+        profiler_record_track(timer->track, PASS_NAMES[pass],
+                              profiler_ticks_at(start + offset), profiler_ticks_at(end + offset));
+    }
+    timer->last[slot] = 0;
+}
+
+void gpu_timer_frame(GpuTimer* timer) {
+    if (!timer->enabled) return;
+
+    // Oldest first, so the frames go to the profiler in order
+    for (int i = 0; i < GPU_TIMER_FRAMES; i++) {
+        int slot = (timer->next + i) % GPU_TIMER_FRAMES;
+        if (!timer->last[slot]) continue;
+
+        // The GPU runs the commands in order, once the last query of a
+        // frame is in so are the others
+        GLuint available = 0;
+        glGetQueryObjectuiv(timer->last[slot], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (available) collect(timer, slot);
+    }
+
+    int slot = timer->next;
+    timer->next = (slot + 1) % GPU_TIMER_FRAMES;
+    if (timer->last[slot]) {
+        // Still in flight, skip timing rather than wait
+        timer->slot = -1;
+        timer->dropped++;
+        return;
+    }
+    timer->slot = slot;
+}
+
+void gpu_timer_begin(GpuTimer* timer, GpuPass pass) {
+    if (!timer->enabled || timer->slot < 0) return;
+    glQueryCounter(timer->queries[timer->slot][pass][0], GL_TIMESTAMP);
+}
+
+void gpu_timer_end(GpuTimer* timer, GpuPass pass) {
+    if (!timer->enabled || timer->slot < 0) return;
+    GLuint query = timer->queries[timer->slot][pass][1];
+    glQueryCounter(query, GL_TIMESTAMP);
+    timer->timed[timer->slot][pass] = true;
+    timer->last[timer->slot]        = query;
+}
+
+void gpu_timer_report(GpuTimer const* timer, FILE* out) {
+    if (!timer->enabled) return;
+
+    fputs("GPU passes: ", out);
+    for (int pass = 0; pass < GPU_PASSES; pass++) {
+        double average = timer->samples[pass] ? timer->total_ms[pass] / timer->samples[pass] : 0.0;
+        fprintf(out, "%s%s avg %.3f ms, last %.3f", pass ? ", " : "", PASS_NAMES[pass], average, timer->ms[pass]);
+    }
+    fprintf(out, ", %ld frames not timed\n", timer->dropped);
+}
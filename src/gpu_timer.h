@@ -0,0 +1,50 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <stdio.h>
+
+#include "util/profiler.h"
+
+enum GpuPass {
+    GPU_CLEAR,
+    GPU_DRAW,
+    GPU_SWAP,
+    GPU_PASSES,
+};
+
+constexpr int GPU_TIMER_FRAMES = 4; // Frames of queries in flight
+
+/// Times the passes of a frame on the GPU with timestamp queries. Every
+/// frame gets its own set of queries out of a pool, they are read
+/// GPU_TIMER_FRAMES frames later, when they are long done, so timing
+/// never stalls the pipeline. Results go to the profiler in a "GPU" row.
+struct GpuTimer {
+    bool    enabled;
+    GLuint  queries[GPU_TIMER_FRAMES][GPU_PASSES][2];   // Timestamps at the start and the end of every pass
+    bool    timed[GPU_TIMER_FRAMES][GPU_PASSES];        // Passes timed in the frame
+    GLuint  last[GPU_TIMER_FRAMES];                     // Query issued last in the frame, 0 if none is pending
+    int     slot;           // Of the current frame, -1 if it isn't timed
+    int     next;           // Slot to try next
+    double  ms[GPU_PASSES]; // GPU time of every pass of the latest frame read
+    double  total_ms[GPU_PASSES];   // Of every frame read, for the average
+    long    samples[GPU_PASSES];    // Frames read with the pass timed
+    long    dropped;        // Frames not timed, as their slot was still in flight
+
+    ProfileTrack* track;
+};
+
+/**
+ * @param enabled Timing off turns every call into a no-op
+ * @returns 0 on success, timing stays off without timer queries
+ */
+int gpu_timer_init(GpuTimer* timer, bool enabled);
+void gpu_timer_free(GpuTimer* timer);
+
+/// Start a frame: collect the frames that finished and take a slot
+void gpu_timer_frame(GpuTimer* timer);
+
+void gpu_timer_begin(GpuTimer* timer, GpuPass pass);
+void gpu_timer_end(GpuTimer* timer, GpuPass pass);
+
+/// Average and latest GPU time of every pass and the frames not timed
+void gpu_timer_report(GpuTimer const* timer, FILE* out);
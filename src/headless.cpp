@@ -0,0 +1,467 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "game.h"
+#include "match_batch.h"
+#include "broadphase.h"
+#include "match_farm.h"
+#include "replay.h"
+#include "util/file.h"
+
+#include <thread>
+
+/// Monotonic time in seconds
+static double now() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/// Starting state of the i-th match, so the matches of a batch differ
+static Game initial_match(int i) {
+    Game game;
+    reset(&game);
+    game.ball.pos.y += (i % 200) - 100;
+    if (i & 1) game.ball.vel.y = -game.ball.vel.y;
+    return game;
+}
+
+static bool same_match(Game const* a, Game const* b) {
+    return a->lpad == b->lpad && a->rpad == b->rpad
+        && !memcmp(&a->remainder_l, &b->remainder_l, sizeof(float))
+        && !memcmp(&a->remainder_r, &b->remainder_r, sizeof(float))
+        && !memcmp(&a->ball, &b->ball, sizeof(Ball));
+}
+
+/// Step a single match
+static int run_single(long ticks, FixedStep const* clock) {
+    Game game;
+    reset(&game);
+
+    // The bot misses now and then, a new rally starts like after a restart
+    long points = 0;
+    double start = now();
+    for (long i = 0; i < ticks; i++) {
+        step(&game, bot_input(&game), clock->delta_time);
+        if (scored(&game)) {
+            reset(&game);
+            points++;
+        }
+    }
+    double elapsed = now() - start;
+
+    printf("%ld ticks in %.3f s: %.0f ticks/s, %ld points\n", ticks, elapsed, ticks / elapsed, points);
+    printf("Final state: lpad %d rpad %d ball (%f, %f)\n",
+           game.lpad, game.rpad, game.ball.pos.x, game.ball.pos.y);
+    return 0;
+}
+
+/// Step many matches with MatchBatch and check them against the scalar path
+static int run_batch(int matches, long ticks, FixedStep const* clock) {
+    MatchBatch batch;
+    if (match_batch_init(&batch, matches)) {
+        fputs("ERROR:BATCH:ALLOC\n", stderr);
+        return -2;
+    }
+    for (int i = 0; i < matches; i++) {
+        Game game = initial_match(i);
+        match_batch_set(&batch, i, &game);
+    }
+
+    double start = now();
+    for (long t = 0; t < ticks; t++) {
+        match_batch_bot_input(&batch, 0, matches);
+        match_batch_step(&batch, 0, matches, clock->delta_time);
+        match_batch_reset_scored(&batch, 0, matches);
+    }
+    double elapsed = now() - start;
+
+    double total = (double) ticks * matches;
+    printf("%d matches x %ld ticks in %.3f s: %.0f match ticks/s\n",
+           matches, ticks, elapsed, total / elapsed);
+
+    // Replay a sample of the matches on the scalar path
+    int checked = matches < 64 ? matches : 64;
+    int status  = 0;
+    for (int i = 0; i < checked; i++) {
+        int m = (int) ((long) i * matches / checked);
+        Game game = initial_match(m);
+        for (long t = 0; t < ticks; t++) {
+            step(&game, bot_input(&game), clock->delta_time);
+            if (scored(&game)) reset(&game);
+        }
+        Game batched = match_batch_get(&batch, m);
+        if (!same_match(&game, &batched)) {
+            fprintf(stderr, "ERROR:BATCH:MISMATCH match %d\n", m);
+            status = -3;
+        }
+    }
+    if (!status) printf("Verified %d matches against the scalar path\n", checked);
+
+    match_batch_free(&batch);
+    return status;
+}
+
+/// Step many matches on a thread pool and check them against a single
+/// threaded run of the same batch
+static int run_farm(int matches, long ticks, FarmConfig const* config, FixedStep const* clock) {
+    MatchBatch farmed = {0}, single = {0};
+    if (match_batch_init(&farmed, matches) || match_batch_init(&single, matches)) {
+        fputs("ERROR:FARM:ALLOC\n", stderr);
+        match_batch_free(&farmed);
+        match_batch_free(&single);
+        return -2;
+    }
+    for (int i = 0; i < matches; i++) {
+        Game game = initial_match(i);
+        match_batch_set(&farmed, i, &game);
+        match_batch_set(&single, i, &game);
+    }
+
+    FarmReport report;
+    if (farm_run(&farmed, config, ticks, clock->delta_time, &report)) {
+        fputs("ERROR:FARM:CONFIG\n", stderr);
+        match_batch_free(&farmed);
+        match_batch_free(&single);
+        return -1;
+    }
+
+    printf("%d matches x %ld ticks on %d threads in %.3f s: %.0f match ticks/s\n",
+           matches, ticks, config->threads, report.seconds, report.match_ticks_per_second);
+    printf("%ld tasks, %ld stolen\n", report.tasks, report.steals);
+    for (int i = 0; i < config->threads; i++) {
+        printf("  thread %2d: %5.1f%% busy\n", i, report.utilization[i] * 100.0);
+    }
+
+    double start = now();
+    for (long t = 0; t < ticks; t++) {
+        match_batch_bot_input(&single, 0, matches);
+        match_batch_step(&single, 0, matches, clock->delta_time);
+        match_batch_reset_scored(&single, 0, matches);
+    }
+    double elapsed = now() - start;
+    printf("Single thread: %.3f s, speedup %.2fx\n", elapsed, elapsed / report.seconds);
+
+    int status = 0;
+    for (int i = 0; i < matches; i++) {
+        Game a = match_batch_get(&farmed, i);
+        Game b = match_batch_get(&single, i);
+        if (!same_match(&a, &b)) {
+            fprintf(stderr, "ERROR:FARM:MISMATCH match %d\n", i);
+            status = -3;
+            break;
+        }
+    }
+    if (!status) printf("All %d matches bit-identical to the single threaded run\n", matches);
+
+    match_batch_free(&farmed);
+    match_batch_free(&single);
+    return status;
+}
+
+/// Record a bot-driven match the way the windowed game records one
+static int run_record(char const* path, long ticks, FixedStep const* clock, int tick_rate) {
+    Recorder* recorder = recorder_open(path, tick_rate);
+    if (!recorder) return -2;
+
+    Game game, prev;
+    reset(&game);
+
+    double start = now();
+    for (long i = 0; i < ticks; i++) {
+        Input input = bot_input(&game);
+        input.should_restart = scored(&game);
+        recorder_tick(recorder, &game, input);
+        run_tick(&prev, &game, &input, clock->delta_time);
+    }
+    recorder_close(recorder);
+    double elapsed = now() - start;
+
+    printf("Recorded %ld ticks to %s in %.3f s\n", ticks, path, elapsed);
+    printf("Final state: lpad %d rpad %d ball (%f, %f)\n",
+           game.lpad, game.rpad, game.ball.pos.x, game.ball.pos.y);
+    return 0;
+}
+
+/// Play a recorded match as fast as possible and check it against its keyframes
+static int run_replay(char const* path) {
+    FileView file;
+    if (map_file(path, &file)) {
+        fprintf(stderr, "ERROR:REPLAY:READ %s\n", path);
+        return -2;
+    }
+
+    ReplayReport report;
+    double start  = now();
+    int    status = replay_play(file.data, file.size, &report);
+    double elapsed = now() - start;
+    if (status) {
+        fprintf(stderr, "ERROR:REPLAY:FORMAT %s\n", path);
+        release_file(&file);
+        return -1;
+    }
+
+    double recorded = (double) report.ticks / report.tick_rate;
+    printf("%lu ticks (%.1f s of play, %ld bytes) in %.3f s: %.0fx realtime\n",
+           (unsigned long) report.ticks, recorded, file.size, elapsed, recorded / elapsed);
+    printf("Final state: lpad %d rpad %d ball (%f, %f)\n",
+           report.game.lpad, report.game.rpad, report.game.ball.pos.x, report.game.ball.pos.y);
+    if (report.truncated) fputs("Ends in a partial record\n", stderr);
+
+    release_file(&file);
+    if (report.corrupt) {
+        fprintf(stderr, "ERROR:REPLAY:CORRUPT unknown record at byte %ld\n", report.corrupt_at);
+        return -4;
+    }
+    if (report.mismatches) {
+        fprintf(stderr, "ERROR:REPLAY:MISMATCH %ld of %ld keyframes, first at tick %lu\n",
+                report.mismatches, report.keyframes, (unsigned long) report.first_mismatch);
+        return -3;
+    }
+    printf("All %ld keyframes reached bit-exactly\n", report.keyframes);
+    return 0;
+}
+
+/// Deterministic pseudo random numbers in [0, 1)
+static float random01(unsigned* state) {
+    *state = *state * 1664525u + 1013904223u;
+    return (*state >> 8) * (1.0f / (1 << 24));
+}
+
+/// Move the balls of a stress arena and bounce them off the field edges
+static void move_balls(AABBPack* balls, float* vx, float* vy, float delta_time) {
+    for (int i = 0; i < balls->count; i++) {
+        balls->x[i] += vx[i] * delta_time;
+        balls->y[i] += vy[i] * delta_time;
+        if ((balls->x[i] < 0 && vx[i] < 0) || (balls->x[i] + BALL_W > WIDTH  && vx[i] > 0)) vx[i] = -vx[i];
+        if ((balls->y[i] < 0 && vy[i] < 0) || (balls->y[i] + BALL_H > HEIGHT && vy[i] > 0)) vy[i] = -vy[i];
+    }
+}
+
+/// Check every SIMD path of the one-against-many collision against
+/// collision(AABB, AABB), on packs whose size isn't a multiple of the
+/// vector width. Boxes on whole pixels, so many touch exactly.
+static int check_collision_paths() {
+    constexpr int PATH_CHECKS = 200;
+    static char const* const PATH_NAMES[COLLISION_PATHS] = { "scalar", "sse2", "avx2" };
+
+    AABBPack pack;
+    unsigned char hits[64];
+    if (aabb_pack_init(&pack, 64)) {
+        fputs("ERROR:BROADPHASE:ALLOC\n", stderr);
+        return -2;
+    }
+
+    unsigned seed = 7;
+    int status = 0;
+    long checked[COLLISION_PATHS] = {0};
+    for (int c = 0; c < PATH_CHECKS && !status; c++) {
+        pack.count = c % 64;
+        auto box = [&] {
+            return AABB { { (float) (int) (random01(&seed) * 40), (float) (int) (random01(&seed) * 40) },
+                          { (float) (int) (random01(&seed) * 10), (float) (int) (random01(&seed) * 10) } };
+        };
+        for (int i = 0; i < pack.count; i++) aabb_pack_set(&pack, i, box());
+        AABB r = box();
+
+        int expected = 0;
+        for (int i = 0; i < pack.count; i++) {
+            expected += collision(r, AABB { { pack.x[i], pack.y[i] }, { pack.w[i], pack.h[i] } });
+        }
+
+        for (int path = 0; path < COLLISION_PATHS; path++) {
+            int n = collision_on((CollisionPath) path, r, &pack, hits);
+            if (n < 0) continue;
+
+            bool same = n == expected;
+            for (int i = 0; i < pack.count && same; i++) {
+                same = hits[i] == collision(r, AABB { { pack.x[i], pack.y[i] }, { pack.w[i], pack.h[i] } });
+            }
+            if (!same) {
+                fprintf(stderr, "ERROR:BROADPHASE:PATH_MISMATCH %s on %d boxes\n", PATH_NAMES[path], pack.count);
+                status = -3;
+            }
+            checked[path]++;
+        }
+    }
+
+    if (!status) {
+        printf("Collision paths agree with collision(AABB, AABB):");
+        for (int path = 0; path < COLLISION_PATHS; path++) {
+            if (checked[path]) printf(" %s", PATH_NAMES[path]);
+        }
+        putchar('\n');
+    }
+
+    pack.count = 64;
+    aabb_pack_free(&pack);
+    return status;
+}
+
+/// Compare the grid broadphase with brute force collision of every ball
+/// against every other one
+static int run_broadphase(int balls_count, FixedStep const* clock) {
+    constexpr int GRID_TICKS = 10;
+
+    AABBPack balls = {0};
+    float* vx = (float*) malloc(sizeof(float) * balls_count);
+    float* vy = (float*) malloc(sizeof(float) * balls_count);
+    unsigned char* hits = (unsigned char*) malloc(balls_count);
+    Grid grid = {0};
+    if (aabb_pack_init(&balls, balls_count) || grid_init(&grid, balls_count, GRID_CELL)
+        || !vx || !vy || !hits) {
+        fputs("ERROR:BROADPHASE:ALLOC\n", stderr);
+        grid_free(&grid);
+        aabb_pack_free(&balls);
+        free(vx);
+        free(vy);
+        free(hits);
+        return -2;
+    }
+
+    unsigned seed = 1;
+    for (int i = 0; i < balls_count; i++) {
+        aabb_pack_set(&balls, i, AABB {
+            { random01(&seed) * (WIDTH - BALL_W), random01(&seed) * (HEIGHT - BALL_H) },
+            { BALL_W, BALL_H } });
+        vx[i] = (random01(&seed) - 0.5f) * 400.0f;
+        vy[i] = (random01(&seed) - 0.5f) * 400.0f;
+    }
+
+    // Brute force, one tick. Every ball collides with itself.
+    double start = now();
+    long brute_hits = 0;
+    for (int i = 0; i < balls_count; i++) {
+        AABB r = { { balls.x[i], balls.y[i] }, { balls.w[i], balls.h[i] } };
+        brute_hits += collision(r, &balls, hits);
+    }
+    brute_hits = (brute_hits - balls_count) / 2;
+    double brute = now() - start;
+
+    // Grid on the same positions, then incrementally while the balls move
+    start = now();
+    grid_update(&grid, &balls);
+    long grid_hits = grid_collisions(&grid, &balls, nullptr, nullptr);
+    double first = now() - start;
+
+    long relinked = 0;
+    start = now();
+    for (int t = 0; t < GRID_TICKS; t++) {
+        move_balls(&balls, vx, vy, clock->delta_time);
+        relinked += grid_update(&grid, &balls);
+        grid_collisions(&grid, &balls, nullptr, nullptr);
+    }
+    double incremental = (now() - start) / GRID_TICKS;
+
+    printf("%7d balls: brute force %10.3f ms, grid build %8.3f ms, grid tick %8.3f ms (%.1f%% relinked)\n",
+           balls_count, brute * 1e3, first * 1e3, incremental * 1e3,
+           100.0 * relinked / ((double) balls_count * GRID_TICKS));
+
+    int status = 0;
+    if (brute_hits != grid_hits) {
+        fprintf(stderr, "ERROR:BROADPHASE:MISMATCH brute force %ld pairs, grid %ld\n", brute_hits, grid_hits);
+        status = -3;
+    }
+
+    grid_free(&grid);
+    aabb_pack_free(&balls);
+    free(vx);
+    free(vy);
+    free(hits);
+    return status;
+}
+
+// Step bot-driven matches without a window as fast as the CPU allows.
+// The ticks are the same fixed ticks the windowed game runs.
+// Usage: headless [ticks] [tick_rate]
+//        headless batch <matches> [ticks] [tick_rate]
+//        headless broadphase [balls...]
+//        headless farm <matches> [ticks] [threads] [chunk] [round_ticks]
+//        headless record <file> [ticks] [tick_rate]
+//        headless replay <file>
+int main(int argc, char **argv) {
+    if (argc > 1 && !strcmp(argv[1], "replay")) {
+        if (argc < 3) {
+            fputs("Usage: headless replay <file>\n", stderr);
+            return -1;
+        }
+        return run_replay(argv[2]);
+    }
+
+    if (argc > 1 && !strcmp(argv[1], "record")) {
+        long ticks     = argc > 3 ? atol(argv[3]) : 100000;
+        int  tick_rate = argc > 4 ? atoi(argv[4]) : TICK_RATE;
+        if (argc < 3 || ticks <= 0 || tick_rate <= 0) {
+            fputs("Usage: headless record <file> [ticks] [tick_rate]\n", stderr);
+            return -1;
+        }
+
+        FixedStep clock;
+        fixed_step_init(&clock, tick_rate);
+        return run_record(argv[2], ticks, &clock, tick_rate);
+    }
+
+    if (argc > 1 && !strcmp(argv[1], "farm")) {
+        int  matches = argc > 2 ? atoi(argv[2]) : 0;
+        long ticks   = argc > 3 ? atol(argv[3]) : 1000;
+
+        FarmConfig config;
+        // Every core by default, as many as the farm takes. Unknown counts as one.
+        int cores = (int) std::thread::hardware_concurrency();
+        cores = cores < 1 ? 1 : cores > FARM_MAX_THREADS ? FARM_MAX_THREADS : cores;
+
+        config.threads      = argc > 4 ? atoi(argv[4]) : cores;
+        config.chunk        = argc > 5 ? atoi(argv[5]) : 1024;
+        config.round_ticks  = argc > 6 ? atoi(argv[6]) : 100;
+
+        if (matches <= 0 || ticks <= 0) {
+            fputs("Usage: headless farm <matches> [ticks] [threads] [chunk] [round_ticks]\n", stderr);
+            return -1;
+        }
+
+        FixedStep clock;
+        fixed_step_init(&clock, TICK_RATE);
+        return run_farm(matches, ticks, &config, &clock);
+    }
+
+    if (argc > 1 && !strcmp(argv[1], "broadphase")) {
+        FixedStep clock;
+        fixed_step_init(&clock, TICK_RATE);
+
+        int default_sizes[] = { 1000, 10000, 100000 };
+        int status = check_collision_paths();
+        if (argc > 2) {
+            for (int i = 2; i < argc && !status; i++) status = run_broadphase(atoi(argv[i]), &clock);
+        } else {
+            for (int size : default_sizes) if (!status) status = run_broadphase(size, &clock);
+        }
+        return status;
+    }
+
+    int matches = 0;
+    if (argc > 1 && !strcmp(argv[1], "batch")) {
+        matches = argc > 2 ? atoi(argv[2]) : 0;
+        if (matches <= 0) {
+            fputs("Usage: headless batch <matches> [ticks] [tick_rate]\n", stderr);
+            return -1;
+        }
+        argc -= 2;
+        argv += 2;
+    }
+
+    long ticks     = argc > 1 ? atol(argv[1]) : (matches ? 1000 : 10000000);
+    int  tick_rate = argc > 2 ? atoi(argv[2]) : TICK_RATE;
+
+    if (ticks <= 0 || tick_rate <= 0) {
+        fputs("Usage: headless [ticks] [tick_rate]\n", stderr);
+        return -1;
+    }
+
+    FixedStep clock;
+    fixed_step_init(&clock, tick_rate);
+
+    if (matches) return run_batch(matches, ticks, &clock);
+    return run_single(ticks, &clock);
+}
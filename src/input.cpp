@@ -1,50 +1,45 @@
 #include "input.h"
-#include <stdio.h>
-#include <memory.h>
 
-// Input mask
-static char MASK = 0;
-constexpr char LEFT_PADDLE_DOWN     = 0b10000000;
-constexpr char RIGHT_PADDLE_DOWN    = 0b01000000;
-constexpr char LEFT_PADDLE_UP       = 0b00100000;
-constexpr char RIGHT_PADDLE_UP      = 0b00010000;
-constexpr char RESET_INPUT          = 0b00001000;
+// Toggled on every press
+std::atomic<bool> OVERLAY(false);
 
+InputQueue INPUT_EVENTS;
 
-Input INPUT = {0};
 void key_callback(GLFWwindow * window, int key, int scancode, int action, int mods) {
-    char mask = 0;
+    if (action == GLFW_REPEAT) return;
 
+    InputCode code;
     switch (key) {
         case(GLFW_KEY_R):
-            mask = RESET_INPUT;
+            code = RESTART;
             break;
         case(GLFW_KEY_J):
-            mask = RIGHT_PADDLE_DOWN;
+            code = RIGHT_PADDLE_DOWN;
             break;
         case(GLFW_KEY_K):
-            mask = RIGHT_PADDLE_UP;
+            code = RIGHT_PADDLE_UP;
             break;
         case(GLFW_KEY_A):
-            mask = LEFT_PADDLE_DOWN;
+            code = LEFT_PADDLE_DOWN;
             break;
         case(GLFW_KEY_S):
-            mask = LEFT_PADDLE_UP;
+            code = LEFT_PADDLE_UP;
             break;
-    }
-    switch (action) {
-        case(GLFW_PRESS):
-            MASK = MASK | mask;
-            break;
-        case(GLFW_RELEASE):
-            MASK = MASK & (MASK ^ mask);
+        case(GLFW_KEY_P):
+            code = PAUSE;
             break;
+        case(GLFW_KEY_F3):
+            // Not part of the match, takes effect right away
+            if (action == GLFW_PRESS) OVERLAY = !OVERLAY;
+            return;
+        default:
+            return;
     }
-    memset(&INPUT, 0, sizeof(INPUT));
 
-    if (MASK & LEFT_PADDLE_UP)      INPUT.ldir              =  1;
-    if (MASK & LEFT_PADDLE_DOWN)    INPUT.ldir              = -1;
-    if (MASK & RIGHT_PADDLE_UP)     INPUT.rdir              =  1;
-    if (MASK & RIGHT_PADDLE_DOWN)   INPUT.rdir              = -1;
-    if (MASK & RESET_INPUT)         INPUT.should_restart    =  1;
+    // Stamped when the event loop delivers it, not when the key went down,
+    // so only as precisely as the loop polls. The main thread of the game
+    // does nothing but wait for events, so that is right away. The
+    // simulation applies it on the tick of the stamp.
+    static uint32_t id = 0;
+    input_queue_push(&INPUT_EVENTS, { glfwGetTimerValue(), ++id, code, action == GLFW_PRESS });
 }
@@ -2,13 +2,13 @@
 
 #include <GLFW/glfw3.h>
 
-struct Input {
-    // Left pad
-    int ldir;
-    // Right pad
-    int rdir;
-    
-    int should_restart;
-
-} extern INPUT;
+#include <atomic>
+
+#include "game.h"
+#include "input_queue.h"
+
+extern InputQueue INPUT_EVENTS; // Key events of the match, in the order they happened
+extern std::atomic<bool> OVERLAY; // Frame time overlay, toggled with F3
+
+/// Queues the key events of the match with the time they happened
 void key_callback(GLFWwindow * window, int key, int scancode, int action, int mods);
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <stdint.h>
+
+#include <atomic>
+
+/// What a key does in the match
+enum InputCode : uint8_t {
+    LEFT_PADDLE_UP,
+    LEFT_PADDLE_DOWN,
+    RIGHT_PADDLE_UP,
+    RIGHT_PADDLE_DOWN,
+    RESTART,
+    PAUSE,
+    INPUT_CODES,
+};
+
+struct InputEvent {
+    uint64_t  time;     // glfwGetTimerValue() when the key callback got it
+    uint32_t  id;       // Counts up from 1 in the order the events happen
+    InputCode code;
+    bool      pressed;  // Released otherwise
+};
+
+constexpr uint32_t INPUT_QUEUE = 256; // Events in flight, a power of two
+
+/// Lock-free ring of input events with a single producer, like the
+/// thread polling the window, and a single consumer, the simulation.
+/// The indices only grow and each side owns one of them, on its own
+/// cache line.
+struct InputQueue {
+    InputEvent events[INPUT_QUEUE];
+    alignas(64) std::atomic<uint32_t> head;    // Next to write, owned by the producer
+    alignas(64) std::atomic<uint32_t> tail;    // Next to read, owned by the consumer
+    alignas(64) uint32_t dropped;              // Events lost to a full queue, producer side
+};
+
+/// Producer only
+/// @returns false if the queue is full and the event was dropped
+inline bool input_queue_push(InputQueue* queue, InputEvent event) {
+    uint32_t head = queue->head.load(std::memory_order_relaxed);
+    if (head - queue->tail.load(std::memory_order_acquire) == INPUT_QUEUE) {
+        queue->dropped++;
+        return false;
+    }
+    queue->events[head % INPUT_QUEUE] = event;
+    queue->head.store(head + 1, std::memory_order_release);
+    return true;
+}
+
+/// Consumer only: look at the oldest event without taking it
+/// @returns false if the queue is empty
+inline bool input_queue_peek(InputQueue* queue, InputEvent* event) {
+    uint32_t tail = queue->tail.load(std::memory_order_relaxed);
+    if (tail == queue->head.load(std::memory_order_acquire)) return false;
+    *event = queue->events[tail % INPUT_QUEUE];
+    return true;
+}
+
+/// Consumer only: drop the event input_queue_peek() returned
+inline void input_queue_pop(InputQueue* queue) {
+    queue->tail.store(queue->tail.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+}
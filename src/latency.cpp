@@ -0,0 +1,130 @@
+#include "latency.h"
+
+#include <string.h>
+#include <time.h>
+
+static char const* const STAGE_NAMES[LATENCY_STAGES] = {
+    "latency_tick", "latency_upload", "latency_swap", "latency_gpu",
+};
+
+static uint64_t clock_ns() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+/// Profiler ticks at a timer value
+static uint64_t to_ticks(LatencyTracker const* tracker, uint64_t time) {
+    double ns = (double) time * 1e9 / tracker->frequency;
+    return profiler_ticks_at((uint64_t) (ns + tracker->offset_ns));
+}
+
+void latency_init(LatencyTracker* tracker, bool enabled, uint64_t now, uint64_t frequency) {
+    memset(tracker, 0, sizeof(*tracker));
+    if (!enabled) return;
+
+    tracker->enabled   = true;
+    tracker->frequency = frequency;
+    tracker->offset_ns = (int64_t) clock_ns() - (int64_t) ((double) now * 1e9 / frequency);
+    tracker->track     = profiler_track("Input latency");
+}
+
+/// Events of a frame are next to each other and share its fence
+static bool fence_shared(LatencyTracker const* tracker, int i) {
+    GLsync fence = tracker->events[i].fence;
+    return (i > 0 && tracker->events[i - 1].fence == fence)
+        || (i + 1 < tracker->count && tracker->events[i + 1].fence == fence);
+}
+
+void latency_free(LatencyTracker* tracker) {
+    for (int i = 0; i < tracker->count; i++) {
+        GLsync fence = tracker->events[i].fence;
+        if (fence && (i + 1 == tracker->count || tracker->events[i + 1].fence != fence)) glDeleteSync(fence);
+    }
+    memset(tracker, 0, sizeof(*tracker));
+}
+
+static void record(LatencyTracker* tracker, LatencyEvent* event, uint64_t now) {
+    profiler_record_track(tracker->track, STAGE_NAMES[event->stage], to_ticks(tracker, event->input), to_ticks(tracker, now));
+    event->stage++;
+}
+
+/// Drop the events that made it through every stage
+static void compact(LatencyTracker* tracker) {
+    int kept = 0;
+    for (int i = 0; i < tracker->count; i++) {
+        if (tracker->events[i].stage < LATENCY_STAGES) tracker->events[kept++] = tracker->events[i];
+    }
+    tracker->count = kept;
+}
+
+void latency_ticked(LatencyTracker* tracker, InputEvent const* events, int count, uint64_t now) {
+    if (!tracker->enabled) return;
+
+    for (int i = 0; i < count; i++) {
+        // Full of events whose frame never got shown, like taps too short
+        // to move a paddle by a pixel. Give up on the oldest.
+        if (tracker->count == LATENCY_TRACKED) {
+            if (tracker->events[0].fence && !fence_shared(tracker, 0)) glDeleteSync(tracker->events[0].fence);
+            memmove(tracker->events, tracker->events + 1, sizeof(LatencyEvent) * (LATENCY_TRACKED - 1));
+            tracker->count--;
+            tracker->lost++;
+        }
+
+        LatencyEvent* event = &tracker->events[tracker->count++];
+        *event = { events[i].id, events[i].time, now, LATENCY_TICK, nullptr };
+        record(tracker, event, now);
+    }
+}
+
+void latency_uploaded(LatencyTracker* tracker, uint64_t through, uint64_t now) {
+    if (!tracker->enabled) return;
+
+    for (int i = 0; i < tracker->count; i++) {
+        LatencyEvent* event = &tracker->events[i];
+        if (event->stage == LATENCY_UPLOAD && event->ticked <= through) record(tracker, event, now);
+    }
+}
+
+void latency_swapped(LatencyTracker* tracker, uint64_t now) {
+    if (!tracker->enabled) return;
+
+    GLsync fence = nullptr;
+    for (int i = 0; i < tracker->count; i++) {
+        LatencyEvent* event = &tracker->events[i];
+        if (event->stage != LATENCY_SWAP) continue;
+
+        record(tracker, event, now);
+        // One fence per frame, every event holds its own reference
+        if (!fence) fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        event->fence = fence;
+    }
+}
+
+void latency_poll(LatencyTracker* tracker, uint64_t now) {
+    if (!tracker->enabled) return;
+
+    GLsync signaled = nullptr;
+    for (int i = 0; i < tracker->count; i++) {
+        LatencyEvent* event = &tracker->events[i];
+        if (event->stage != LATENCY_GPU) continue;
+
+        if (event->fence != signaled) {
+            GLenum status = glClientWaitSync(event->fence, 0, 0);
+            if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) continue;
+            signaled = event->fence;
+        }
+        record(tracker, event, now);
+    }
+
+    // Events of one frame share a fence, delete it once
+    GLsync deleted = nullptr;
+    for (int i = 0; i < tracker->count; i++) {
+        LatencyEvent* event = &tracker->events[i];
+        if (event->stage < LATENCY_STAGES || !event->fence) continue;
+        if (event->fence != deleted) glDeleteSync(event->fence);
+        deleted = event->fence;
+        event->fence = nullptr;
+    }
+    compact(tracker);
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <GL/glew.h>
+
+#include "input_queue.h"
+#include "util/profiler.h"
+
+constexpr int LATENCY_TRACKED = 64; // Input events followed at once, older ones are given up on
+
+enum LatencyStage {
+    LATENCY_TICK,       // A tick applied the event
+    LATENCY_UPLOAD,     // The instances showing its effect were uploaded
+    LATENCY_SWAP,       // glfwSwapBuffers() returned for that frame
+    LATENCY_GPU,        // The GPU finished the frame, as its fence says
+    LATENCY_STAGES,
+};
+
+/// An input event on its way to the screen
+struct LatencyEvent {
+    uint32_t id;
+    uint64_t input;     // Timer value of the key event
+    uint64_t ticked;    // Timer value of the tick that applied it
+    int      stage;     // Next stage it waits for
+    GLsync   fence;     // Set at the swap
+};
+
+/// Follows input events from the key callback to the GPU finishing the
+/// frame that shows them. Every stage is recorded into the profiler as
+/// a zone from the key event to the stage, in an "Input latency" row,
+/// so the profiler summary shows the latency percentiles per stage.
+struct LatencyTracker {
+    bool          enabled;
+    uint64_t      frequency;    // Of the timer the events are stamped with
+    int64_t       offset_ns;    // CLOCK_MONOTONIC minus the timer, in nanoseconds
+    LatencyEvent  events[LATENCY_TRACKED];
+    int           count;
+    long          lost;         // Events given up on
+    ProfileTrack* track;
+};
+
+/**
+ * @param enabled Tracking off turns every call into a no-op
+ * @param now Timer value, to line the timer up with the profiler clock
+ * @param frequency Timer values in a second
+ */
+void latency_init(LatencyTracker* tracker, bool enabled, uint64_t now, uint64_t frequency);
+void latency_free(LatencyTracker* tracker);
+
+/// Events a tick applied at now
+void latency_ticked(LatencyTracker* tracker, InputEvent const* events, int count, uint64_t now);
+
+/**
+ * The instances of a snapshot were uploaded at now. Only events it
+ * shows are stamped, the ones applied by its last tick or before.
+ * @param through Timer value of the last tick in the snapshot
+ */
+void latency_uploaded(LatencyTracker* tracker, uint64_t through, uint64_t now);
+
+/// The frame was swapped at now. Sets the fence the GPU stage waits for.
+void latency_swapped(LatencyTracker* tracker, uint64_t now);
+
+/// Check the fences without waiting, call every frame
+void latency_poll(LatencyTracker* tracker, uint64_t now);
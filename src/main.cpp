@@ -1,318 +1,69 @@
 #include <stdio.h>
 #include <string.h>
+#include <stdlib.h>
 #include <malloc.h>
 
-#include <glm/vec3.hpp>
-#include <glm/vec2.hpp>
-#include <glm/geometric.hpp>
+#include <atomic>
+#include <thread>
 
 #include "util/file.h"
+#include "util/loader.h"
+#include "util/profiler.h"
 #include "setup_opengl.h"
 #include "input.h"
-#include "collision.h"
-
-Resource RESOURCE;
-
-struct Ball {
-    glm::vec2 pos;
-    glm::vec2 vel;
-};
-
-/** Convert pixel coordinates to clip coordinates
- * @param window_size Size of the window along the converted axis
- */
-inline float to_clip(int coord, int window_size) {
-    return (((float) coord / (float) window_size) - 0.5f) * 2.0f;
-}
-
-/**
- * Generate the verticies for the rectangle
- * @param w Width in pixels
- * @param h Height in pixels
- * @param window_w Window width in pixels
- * @param window_h Window height in pixels
- * @param posx Position x of the top left pixel
- * @param posy Position y of the top left pixel
- * @param ptr store generated verticies here
- */
-template <typename T>
-void gen_rectangle_verticies(
-        T w,
-        T h,
-        T window_w,
-        T window_h,
-        T posx,
-        T posy,
-        glm::vec3* ptr) {
-
-    float posxcl = to_clip(posx,        window_w); // Left clip position
-    float posxcr = to_clip(posx + w,    window_w); // Right clip position
-    float posyct = to_clip(posy,        window_h); // Top clip position
-    float posycb = to_clip(posy + h,    window_h); // Bottom clip position
-
-    glm::vec3 verticies[4] = {
-        {  posxcl,      posyct,      0.0f },
-        {  posxcl,      posycb,      0.0f },
-        {  posxcr,      posycb,      0.0f },
-        {  posxcr,      posyct,      0.0f },
-    };
-    memcpy(ptr, verticies, sizeof(verticies));
-}
-
-constexpr int PADDLE_W = 10; // Width of the paddle in pixels
-constexpr int PADDLE_H = 50; // Height of the paddle in pixels
-
-constexpr int BALL_W        = 10;
-constexpr int BALL_H        = 10;
-constexpr float BALL_SPEED  = 10.0f;
-constexpr float SPEED_MOD   = 1.2f;
-
-constexpr int PADDING = 30;  // Distance from the edge of the screen in pixels
-
-
-constexpr float PADSPEED = 30.0f;
-/**
- * Update the paddles according to the current input.
- * @param lpp Left paddle position vertically
- * @param rpp Right paddle position vertically
- * @param delta_time Time between two last updates
- * @returns If any displacement is present
- */
-bool update_paddles(Input INPUT, int &lpp, int &rpp, float delta_time) {
-    static float remainder_r {0};
-    static float remainder_l {0};
-
-    float ldisplacement = (INPUT.ldir) * PADSPEED;
-    float rdisplacement = (INPUT.rdir) * PADSPEED;
-
-    float flr_dis = ldisplacement * delta_time + remainder_l; // Real left displacement
-    float frr_dis = rdisplacement * delta_time + remainder_r; // Real right displacement
-
-    int lr_dis = floor(flr_dis);
-    int rr_dis = floor(frr_dis);
-
-    remainder_r = frr_dis - rr_dis;
-    remainder_l = flr_dis - lr_dis;
-                          // + 5 for bias                             // + 5 for the same reason
-    lr_dis *= !(lpp + lr_dis + 5 < 0 || lpp + lr_dis > HEIGHT - PADDLE_H + 5);    // Don't get out of the screen
-    rr_dis *= !(rpp + rr_dis + 5 < 0 || rpp + rr_dis > HEIGHT - PADDLE_H + 5);    // Don't get out of the screen
-
-    lpp += lr_dis;
-    rpp += rr_dis;
-
-    return (lr_dis != 0 || rr_dis != 0);
-}
-
-void update_ball(Ball* ball, int lpad, int rpad, float delta_time) {
-
-    // Move the ball->with its velocity
-    ball->pos += ball->vel * delta_time;
-
-    AABB ball_aabb      = { ball->pos, { BALL_W, BALL_H } };
-    AABB lpaddle_aabb   = { { PADDING, lpad }, {PADDLE_W, PADDLE_H} };
-    AABB rpaddle_aabb   = { { WIDTH - PADDING - PADDLE_W, rpad }, {PADDLE_W, PADDLE_H} };
-    // Check if the ball->collided with the left paddle
-    // if (ball->vel.x < 0 && ball->pos.x < PADDING + PADDLE_W                // Collide horizontally
-    //     && (ball->pos.y < lpad + PADDLE_H && ball->pos.y + BALL_H > lpad)) // Collide vertically
-    // {
-    //     ball->vel.x = -ball->vel.x;
-    //     return;
-    if (collision(ball_aabb, lpaddle_aabb)) {
-        ball->vel.x = -ball->vel.x;
-        glm::vec2 random_v = { ball->vel.x, ball->vel.y };
-        ball->vel += random_v;
-    }
-    if (collision(ball_aabb, rpaddle_aabb)) {
-        ball->vel.x = SPEED_MOD * -ball->vel.x;
-    }
-    // }
-    // Check if the ball->collided with the right paddle
-    // if (ball->vel.x > 0 && ball->pos.x + BALL_W > (WIDTH - PADDING - PADDLE_W)      // Collidre horizontally
-    //     && (ball->pos.y < rpad + PADDLE_H && ball->pos.y + BALL_H > rpad))          // Collide vertically
-    // {
-    //     ball->vel.x = -ball->vel.x;
-    //     return;
-    // }
-
-    // Check if the ball->collided with the ceiling
-    if (ball->pos.y < 0) {
-        ball->vel.y = -ball->vel.y;
-        return;
-    }
-    // Check if the ball->collided with the floor
-    if (ball->pos.y + BALL_H > HEIGHT) {
-        ball->vel.y = -ball->vel.y;
-        return;
-    }
-}
-
-/// Set the positions of all the objects to the default ones
-void reset(int & lpad, int & rpad, Ball * ball) {
-    lpad = (HEIGHT - PADDLE_H) >> 1;
-    rpad = lpad;
-
-    ball->pos.x = (float) ((WIDTH  - BALL_W) >> 1);
-    ball->pos.y = (float) ((HEIGHT - BALL_H) >> 1);
-    // Reset the velocity of a ball
-    ball->vel = glm::vec2(-1.0f) * BALL_SPEED;
-}
-
-static float BG_COLOR[] = {0.2f, 0.2f, 0.2f, 1.0f};
+#include "game.h"
+#include "sim_thread.h"
+#include "renderer.h"
+#include "frame_stats.h"
+#include "frame_pacer.h"
+#include "latency.h"
+#include "shader.h"
+#include "shader_watch.h"
 
 int terminate(int status) {
     glfwTerminate();
     return status;
 }
 
-void render(int VAO) {
-    glClearColor(BG_COLOR[0], BG_COLOR[1], BG_COLOR[2], BG_COLOR[3]);
-    glClear(GL_COLOR_BUFFER_BIT);
-
-    glBindVertexArray(VAO);
-    glDrawElements(GL_TRIANGLES, 18, GL_UNSIGNED_INT, nullptr);
-    // glDrawArrays(GL_TRIANGLES, 0, 3);
-}
-
-GLuint compile_shader(const char *const source, GLint length, GLuint type) {
-    GLuint shader = glCreateShader(type);
-    glShaderSource(shader, 1, &source, &length);
-    glCompileShader(shader);
-
-    int success;
-    glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
-
-    if (!success) {
-        char error_desc[512];
-        glGetShaderInfoLog(shader, 512, nullptr, error_desc);
-        fprintf(stderr, "ERROR:SHADER:COMPILE %s\n", error_desc);
-        fprintf(stderr, "%s\n", source);
-
-        return 0;
-    }
-
-    return shader;
+static void keep_source(char const* path, int status, FileView* source, void* user) {
+    *(FileView*) user = *source;
 }
 
 int setup_shaders(GLuint *shader_program) {
-    // Vertex shader
-    char* shader_v = (char*) malloc(512);
-    char* shader_f = (char*) malloc(512);
-
-    GLint vbytes; // Bytes of vertex shader
-    GLint fbytes; // Bytes of frag   shader
+    FileView shader_v = {0}; // Vertex shader source
+    FileView shader_f = {0}; // Fragment shader source
 
-    GLuint shf; // Handle to a fragment shader
-    GLuint shv; // Handle to a vertex shader
     GLuint program = 0; // Handle to a shader program
 
+    // Both sources are read in parallel, so startup waits for the
+    // slowest read only
     int status;
     {
-        status = get_resource("shader/default.vert", shader_v, vbytes);
+        Loader* loader = loader_create(2);
+        status = load_async(loader, DEFAULT_VERTEX, keep_source, &shader_v);
+        if (!status) status = load_async(loader, DEFAULT_FRAGMENT, keep_source, &shader_f);
+        loader_wait(loader);
+        loader_destroy(loader);
         if (status) goto OUT;
-
-        status = get_resource("shader/default.frag", shader_f, fbytes);
-        if (status) goto OUT;
-    }
-    shf = compile_shader(shader_f, fbytes, GL_FRAGMENT_SHADER);
-    if (!shf) { status = -5; goto OUT; }
-    shv = compile_shader(shader_v, vbytes, GL_VERTEX_SHADER);
-    if (!shv) { status = -6; goto OUT; }
-
-    program = glCreateProgram();
-    glAttachShader(program, shv);
-    glAttachShader(program, shf);
-    glLinkProgram(program);
-
-    int success;
-    glGetProgramiv(program, GL_LINK_STATUS, &success);
-    if (!success) {
-        char infoLog[512];
-        glGetProgramInfoLog(program, 512, nullptr, infoLog);
-        fprintf(stderr, "ERROR:SHADER:LINK %s\n", infoLog);
+        if (!shader_v.data || !shader_f.data) { status = -1; goto OUT; }
     }
 
+    // Straight from the binary cache unless the sources or the driver changed
+    program = build_program("default", &shader_v, &shader_f);
+    if (!program) { status = -5; goto OUT; }
+
     glUseProgram(program);
 
     // Goto clean
 OUT:
-    free(shader_v);
-    free(shader_f);
+    release_file(&shader_v);
+    release_file(&shader_f);
 
     *shader_program = program;
 
     return status;
 }
 
-struct VBO {
-    GLuint      layout_id;
-    GLuint      handle;
-    GLuint      component_type;
-    int         arrsize;
-    int         component_size;
-    int         stride;
-    void*       verticies;
-    long int    offset = 0;
-    GLuint      draw_mode = GL_STATIC_DRAW;
-
-    void init() {
-        glBindBuffer(GL_ARRAY_BUFFER, handle);
-        glBufferData(GL_ARRAY_BUFFER, arrsize, verticies, draw_mode);
-        glVertexAttribPointer(layout_id, component_size, GL_FLOAT, GL_FALSE, stride, (void*) offset);
-        glEnableVertexAttribArray(layout_id);
-    }
-};
-
-/**
- * @param verticies Verticies containing two paddles and a ball
- * @param size size of verticies
- */
-GLuint
-setup_VAO(VBO& vbo, glm::vec3* verticies, int size) {
-    GLuint VBOhandle, EBO;
-
-    GLuint VAO;
-    glGenVertexArrays(1, &VAO);
-    glGenBuffers(1, &VBOhandle);
-    glGenBuffers(1, &EBO);
-
-    glBindVertexArray(VAO);
-
-    GLuint indicies[] = {
-        // Left paddle
-        0, 1, 2,
-        2, 3, 0,
-
-        // Right paddle
-        4, 5, 6,
-        6, 7, 4,
-
-        // Ball
-        8, 9, 10,
-        10, 11, 8
-    };
-
-    /// Rectangle points
-    vbo = {
-        .layout_id      = 0,
-        .handle         = VBOhandle,
-        .component_type = GL_FLOAT,
-        .arrsize        = size,
-        .component_size = 3,
-        .stride         = sizeof(float) * 3,
-        .verticies      = verticies,
-        .draw_mode      = GL_DYNAMIC_DRAW,
-    };
-
-    vbo.init();
-
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indicies), indicies, GL_DYNAMIC_DRAW);
-
-    glBindVertexArray(0);
-
-    return VAO;
-}
-
 void fetch_errors() {
     fputs("Fetching errors...\n", stderr);
     GLenum err;
@@ -321,33 +72,197 @@ void fetch_errors() {
     }
 }
 
+// Set when the window contents are lost and the frame must be drawn even
+// if nothing moved
+static std::atomic<bool> REDRAW(true);
+
+// Size of the framebuffer, set on the main thread and applied by the
+// render thread, which has the context
+static std::atomic<int>  VIEWPORT_W(WIDTH);
+static std::atomic<int>  VIEWPORT_H(HEIGHT);
+static std::atomic<bool> RESIZED(false);
+
 // Update window's viewport after resizing
 void resize_callback(GLFWwindow* window, int w, int h) {
-    glViewport(0, 0, w, h);
+    VIEWPORT_W = w;
+    VIEWPORT_H = h;
+    RESIZED = true;
+    REDRAW = true;
 }
 
+void refresh_callback(GLFWwindow* window) {
+    REDRAW = true;
+}
+
+/// What the render thread draws with, set up on the main thread
+struct RenderLoop {
+    GLFWwindow*     window;
+    GLuint          shader_program;
+    Renderer*       renderer;
+    GpuTimer*       gpu_timer;
+    ShaderWatch*    watch;
+    SimThread*      sim;
+    FrameStats*     frame_stats;
+    FramePacer*     pacer;
+    PaceMode        pace;
+    int             refresh;    // Of the monitor, in Hz
+    LatencyTracker* latency;
+    std::atomic<bool> quit;
+};
+
+/// Draw the newest snapshot of the simulation whenever the pacer says,
+/// with the context of the window current on this thread only
+static void render_loop(RenderLoop* loop) {
+    glfwMakeContextCurrent(loop->window);
+
+    Renderer*       renderer    = loop->renderer;
+    GpuTimer*       gpu_timer   = loop->gpu_timer;
+    FrameStats*     frame_stats = loop->frame_stats;
+    FramePacer*     pacer       = loop->pacer;
+    LatencyTracker* latency     = loop->latency;
+
+    // The swap interval belongs to the context
+    frame_pacer_init(pacer, loop->pace, loop->refresh);
+
+    Instance instances[MAX_INSTANCES];
+    uint32_t seen = 0; // Newest input event handed to the latency tracker
+
+    double time = glfwGetTime();
+    double shown = time;    // When the last frame was swapped in
+    bool   idled = false;   // Idled since the last frame, the next delta says nothing about pacing
+#ifdef PROFILER
+    constexpr double PROFILE_REPORT = 5.0; // Seconds between zone summaries
+    double last_report = time;
+#endif
+
+    while (!loop->quit.load(std::memory_order_relaxed)) {
+        {
+            PROFILE_ZONE("pace");
+            frame_pacer_wait(pacer);
+        }
+        latency_poll(latency, glfwGetTimerValue());
+
+        if (RESIZED.exchange(false)) glViewport(0, 0, VIEWPORT_W, VIEWPORT_H);
+
+        if (GLuint reloaded = shader_watch_take(loop->watch)) {
+            if (renderer_use_program(renderer, reloaded)) {
+                glDeleteProgram(reloaded);
+            } else {
+                glDeleteProgram(loop->shader_program);
+                loop->shader_program = reloaded;
+                REDRAW = true;
+            }
+        }
+
+#ifdef PROFILER
+        double now = glfwGetTime();
+        if (now - last_report >= PROFILE_REPORT) {
+            profiler_report(stderr);
+            last_report = now;
+        }
+#endif
+
+        Snapshot const* snapshot = sim_latest(loop->sim);
+        RenderState state;
+        {
+            PROFILE_ZONE("interpolate");
+            for (int i = 0; i < snapshot->taken_count; i++) {
+                if (snapshot->taken[i].id <= seen) continue;
+                latency_ticked(latency, &snapshot->taken[i], 1, snapshot->taken_at[i]);
+                seen = snapshot->taken[i].id;
+            }
+            state = interpolate(&snapshot->prev, &snapshot->curr, snapshot_alpha(snapshot, glfwGetTimerValue()));
+        }
+
+        int count;
+        {
+            PROFILE_ZONE("gen_instances");
+            count = gen_instances(&state, instances);
+            if (OVERLAY) count += gen_overlay(frame_stats, instances + count);
+        }
+        bool changed;
+        {
+            PROFILE_ZONE("renderer_upload");
+            changed = renderer_upload(renderer, instances, count);
+            if (changed) latency_uploaded(latency, snapshot->time, glfwGetTimerValue());
+        }
+
+        // Nothing moved, don't spend anything until the next tick could
+        // change that. Even paused, as the input lands on the simulation
+        // thread and doesn't show until then.
+        bool redraw = REDRAW.exchange(false);
+        if (!changed && !redraw) {
+            frame_pacer_idle(pacer, snapshot->tick);
+            idled = true;
+            continue;
+        }
+
+        gpu_timer_frame(gpu_timer);
+        {
+            PROFILE_ZONE("render");
+            render(renderer, count, gpu_timer);
+            frame_pacer_submitted(pacer);
+        }
+        {
+            PROFILE_ZONE("swap");
+            gpu_timer_begin(gpu_timer, GPU_SWAP);
+            glfwSwapBuffers(loop->window);
+            gpu_timer_end(gpu_timer, GPU_SWAP);
+            frame_pacer_swapped(pacer);
+        }
+        latency_swapped(latency, glfwGetTimerValue());
+        latency_poll(latency, glfwGetTimerValue());
+
+        double swapped = glfwGetTime();
+        if (!idled) frame_stats_add(frame_stats, swapped - shown);
+        shown = swapped;
+        idled = false;
+    }
+
+    glfwMakeContextCurrent(nullptr);
+}
 
 // Supply the path to the 'resources' folder via command line
-// arguments.
+// arguments. The simulation rate in ticks per second may follow.
+// Binaries built with the resources embedded take '-', or nothing, for
+// the built-in ones and the path only to override them.
 int main(int argc, char **argv) {
-    if (argc < 2) {
-        fputs("Usage: app <path/to/the/resource_dir>\n", stderr);
+    char const* resources = argc > 1 ? argv[1] : "-";
+    int tick_rate = argc > 2 ? atoi(argv[2]) : TICK_RATE;
+    if (tick_rate <= 0) {
+        fputs("ERROR:TICK_RATE must be positive\n", stderr);
         return -1;
     }
 
+    int bytes = strlen(resources); // Bytes used by an argument ( excluding the '\0' )
+    constexpr char PACK_SUFFIX[] = ".pack";
+    constexpr int  SUFFIX_BYTES  = sizeof(PACK_SUFFIX) - 1;
+
+    if (!strcmp(resources, "-")) {
+        if (mount_embedded()) {
+            fputs("Usage: app <path/to/the/resource_dir | resource.pack> [tick_rate]\n", stderr);
+            return -1;
+        }
+    }
+    else if (bytes > SUFFIX_BYTES && !strcmp(resources + bytes - SUFFIX_BYTES, PACK_SUFFIX)) {
+        // All the resources from a single mapped archive
+        if (mount_pack(resources)) return -1;
+    }
     // Save resource dir to a static storage.
-    {
-        int bytes = strlen(argv[1]); // Bytes used by an argument ( including the '\0' )
+    else {
+        // Room for the '/' and the '\0'
+        if (bytes + 2 > (int) sizeof(RESOURCE.DIR)) {
+            fputs("ERROR:RESOURCE_DIR path too long\n", stderr);
+            return -1;
+        }
+        memcpy(RESOURCE.DIR, resources, bytes);
 
         // Check if the user added the '/' at the end
-        if (argv[1][bytes - 1] != '/') {
-            argv[1][bytes + 0] = '/';
-            argv[1][bytes + 1] = 0;
-
-            bytes++;
+        if (bytes == 0 || RESOURCE.DIR[bytes - 1] != '/') {
+            RESOURCE.DIR[bytes++] = '/';
         }
+        RESOURCE.DIR[bytes] = 0;
         RESOURCE.BYTES = bytes;
-        memcpy(RESOURCE.DIR, argv[1], bytes);
     }
 
     // Window
@@ -357,47 +272,9 @@ int main(int argc, char **argv) {
     if (status) return terminate(status);
 
     glfwSetFramebufferSizeCallback(window, resize_callback);
+    glfwSetWindowRefreshCallback(window, refresh_callback);
     glfwSetKeyCallback(window, key_callback);
 
-    glm::vec3 verticies[12];
-
-    // Setup the paddles and the ball
-    int lpad, rpad; // Positions of the top left pixel of the left and the right paddle
-    Ball ball;
-
-    reset(lpad, rpad, &ball);
-
-    // Left paddle
-    gen_rectangle_verticies(
-        PADDLE_W,
-        PADDLE_H,
-        WIDTH,
-        HEIGHT,
-        PADDING,
-        lpad,
-        verticies);
-
-    // Right paddle
-    gen_rectangle_verticies(
-        PADDLE_W,
-        PADDLE_H,
-        WIDTH,
-        HEIGHT,
-        WIDTH - PADDING - PADDLE_W,
-        rpad,
-        verticies + 4);
-    // Ball
-    gen_rectangle_verticies<float>(
-        BALL_W,
-        BALL_H,
-        WIDTH,
-        HEIGHT,
-        ball.pos.x,
-        ball.pos.y,
-        verticies + 8);
-
-    VBO vbo;
-    GLuint VAOhandle = setup_VAO(vbo, verticies, sizeof(verticies));
     GLuint shader_program;
 
     status = setup_shaders(&shader_program);
@@ -405,39 +282,92 @@ int main(int argc, char **argv) {
 
     glUseProgram(shader_program);
 
-    // Time at the startup
-    float time0 = glfwGetTime();
-    float time = 0;
-
-    fetch_errors();
-    // Render loop
-    while (!glfwWindowShouldClose(window)) {
-        if (INPUT.should_restart) reset(lpad, rpad, &ball);
-        // Time since the startup
-        float delta_time = glfwGetTime() - time;
-        time = glfwGetTime() - time0;
-
-        update_paddles(INPUT, lpad, rpad, delta_time);
-        update_ball(&ball, lpad, rpad, delta_time);
-
-        // Left paddle
-        gen_rectangle_verticies(PADDLE_W, PADDLE_H, WIDTH, HEIGHT, PADDING, lpad, verticies);
+    Renderer renderer;
+    status = renderer_init(&renderer, shader_program);
+    if (status) return terminate(status);
 
-        // Right paddle
-        gen_rectangle_verticies(PADDLE_W, PADDLE_H, WIDTH, HEIGHT, WIDTH - PADDING - PADDLE_W, rpad, verticies + 4);
+    // GPU time of the passes, next to the CPU zones of the profiler
+    GpuTimer gpu_timer;
+    if (gpu_timer_init(&gpu_timer, PROFILER_ENABLED)) fputs("GPU timing off, the profiler shows the CPU only\n", stderr);
+
+    // Edits to the shaders show up without a restart
+    ShaderWatch* watch = shader_watch_start(window);
+
+    // Frames 1.5 refreshes apart or more are stutters
+    GLFWvidmode const* mode = glfwGetVideoMode(glfwGetPrimaryMonitor());
+    int refresh = mode && mode->refreshRate > 0 ? mode->refreshRate : 60;
+    FrameStats frame_stats;
+    frame_stats_init(&frame_stats, 1.5e3 / refresh);
+
+    // Vsync unless PONG_PACING asks for another mode
+    char const* pacing = getenv("PONG_PACING");
+    int pace = pacing ? pace_mode(pacing) : PACE_VSYNC;
+    if (pace < 0) {
+        fputs("ERROR:PONG_PACING must be uncapped, vsync, adaptive or jit\n", stderr);
+        return terminate(-1);
+    }
+    FramePacer pacer;
 
-        // Ball
-        gen_rectangle_verticies<float>(BALL_W, BALL_H, WIDTH, HEIGHT, ball.pos.x, ball.pos.y, verticies + 8);
+    // Recorded for headless playback if PONG_REPLAY names a file
+    char const* replay = getenv("PONG_REPLAY");
+    Recorder* recorder = replay ? recorder_open(replay, tick_rate) : nullptr;
 
-        // Supply VBO with new data
-        glBindBuffer(GL_ARRAY_BUFFER, vbo.handle);
-        glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(verticies), verticies);
+    // The match ticks on its own thread, whatever the swaps take. Key
+    // events are stamped on the GLFW timer, its clock follows it.
+    SimThread* sim = sim_start(tick_rate, &INPUT_EVENTS, glfwGetTimerValue(), glfwGetTimerFrequency(), glfwGetTimerValue,
+                               recorder);
 
-        render(VAOhandle);
+    // Key event to tick, upload, swap and GPU, in the profiler
+    LatencyTracker latency;
+    latency_init(&latency, PROFILER_ENABLED, glfwGetTimerValue(), glfwGetTimerFrequency());
 
-        glfwSwapBuffers(window);
-        glfwPollEvents();
-    }
+    fetch_errors();
 
+    // Frames are drawn on a thread of their own. The main thread does
+    // nothing but wait for events, so the key callback stamps every key
+    // as it arrives instead of once a frame, after the swap.
+    RenderLoop loop;
+    loop.window         = window;
+    loop.shader_program = shader_program;
+    loop.renderer       = &renderer;
+    loop.gpu_timer      = &gpu_timer;
+    loop.watch          = watch;
+    loop.sim            = sim;
+    loop.frame_stats    = &frame_stats;
+    loop.pacer          = &pacer;
+    loop.pace           = (PaceMode) pace;
+    loop.refresh        = refresh;
+    loop.latency        = &latency;
+    loop.quit           = false;
+
+    glfwMakeContextCurrent(nullptr);
+    std::thread render_thread(render_loop, &loop);
+    while (!glfwWindowShouldClose(window)) glfwWaitEvents();
+    loop.quit = true;
+    render_thread.join();
+
+    // Back to this thread, the queries, the fences and the program of
+    // the shader watch are deleted with it
+    glfwMakeContextCurrent(window);
+
+    // Nothing records into the profiler once both threads are gone
+    sim_stop(sim);
+    if (recorder) recorder_close(recorder);
+
+    frame_stats_report(&frame_stats, stderr);
+    frame_pacer_report(&pacer, stderr);
+    gpu_timer_report(&gpu_timer, stderr);
+    gpu_timer_free(&gpu_timer);
+    fprintf(stderr, "Input events dropped to a full queue: %u\n", INPUT_EVENTS.dropped);
+    if (latency.enabled) fprintf(stderr, "Input events the latency tracker gave up on: %ld\n", latency.lost);
+    latency_free(&latency);
+    if (char const* csv = getenv("PONG_FRAMES")) frame_stats_write_csv(&frame_stats, csv);
+
+#ifdef PROFILER
+    char const* trace = getenv("PONG_TRACE");
+    profiler_write_trace(trace ? trace : "trace.json");
+#endif
+
+    shader_watch_stop(watch);
     terminate(0);
 }
@@ -0,0 +1,189 @@
+#include "match_batch.h"
+
+#include <math.h>
+#include <stdlib.h>
+
+// Every array starts on a cache line and is padded to a whole number of them
+constexpr size_t ALIGNMENT = 64;
+
+template <typename T>
+static T* alloc_array(int count) {
+    size_t bytes = (count * sizeof(T) + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+    return (T*) aligned_alloc(ALIGNMENT, bytes);
+}
+
+int match_batch_init(MatchBatch* batch, int count) {
+    batch->count        = count;
+    batch->ball_x       = alloc_array<float>(count);
+    batch->ball_y       = alloc_array<float>(count);
+    batch->vel_x        = alloc_array<float>(count);
+    batch->vel_y        = alloc_array<float>(count);
+    batch->lpad         = alloc_array<int>(count);
+    batch->rpad         = alloc_array<int>(count);
+    batch->remainder_l  = alloc_array<float>(count);
+    batch->remainder_r  = alloc_array<float>(count);
+    batch->ldir         = alloc_array<int>(count);
+    batch->rdir         = alloc_array<int>(count);
+
+    if (!batch->ball_x || !batch->ball_y || !batch->vel_x || !batch->vel_y
+        || !batch->lpad || !batch->rpad || !batch->remainder_l || !batch->remainder_r
+        || !batch->ldir || !batch->rdir) {
+        match_batch_free(batch);
+        return -1;
+    }
+
+    Game game;
+    reset(&game);
+    for (int i = 0; i < count; i++) {
+        match_batch_set(batch, i, &game);
+        batch->ldir[i] = 0;
+        batch->rdir[i] = 0;
+    }
+    return 0;
+}
+
+void match_batch_free(MatchBatch* batch) {
+    free(batch->ball_x);
+    free(batch->ball_y);
+    free(batch->vel_x);
+    free(batch->vel_y);
+    free(batch->lpad);
+    free(batch->rpad);
+    free(batch->remainder_l);
+    free(batch->remainder_r);
+    free(batch->ldir);
+    free(batch->rdir);
+    *batch = {0};
+}
+
+void match_batch_set(MatchBatch* batch, int i, Game const* game) {
+    batch->ball_x[i]        = game->ball.pos.x;
+    batch->ball_y[i]        = game->ball.pos.y;
+    batch->vel_x[i]         = game->ball.vel.x;
+    batch->vel_y[i]         = game->ball.vel.y;
+    batch->lpad[i]          = game->lpad;
+    batch->rpad[i]          = game->rpad;
+    batch->remainder_l[i]   = game->remainder_l;
+    batch->remainder_r[i]   = game->remainder_r;
+}
+
+Game match_batch_get(MatchBatch const* batch, int i) {
+    Game game;
+    game.ball.pos.x     = batch->ball_x[i];
+    game.ball.pos.y     = batch->ball_y[i];
+    game.ball.vel.x     = batch->vel_x[i];
+    game.ball.vel.y     = batch->vel_y[i];
+    game.lpad           = batch->lpad[i];
+    game.rpad           = batch->rpad[i];
+    game.remainder_l    = batch->remainder_l[i];
+    game.remainder_r    = batch->remainder_r[i];
+    return game;
+}
+
+// The loops below repeat the arithmetic of game.cpp operation for
+// operation (same types, same order), only the branches are turned into
+// selects. Keep them in sync, or the batch stops matching the scalar path.
+// The ball shares move_ball() with update_ball().
+// The kernels take restrict pointers already offset to the first match,
+// so the compiler can prove the arrays don't alias.
+
+static void bot_input_kernel(
+        int n,
+        float const* __restrict ball_y,
+        int const*   __restrict lpad,
+        int const*   __restrict rpad,
+        int*         __restrict ldir,
+        int*         __restrict rdir) {
+
+    for (int i = 0; i < n; i++) {
+        float y = ball_y[i] + BALL_H * 0.5f;
+
+        float lcenter = lpad[i] + PADDLE_H * 0.5f;
+        float rcenter = rpad[i] + PADDLE_H * 0.5f;
+
+        ldir[i] = (y > lcenter + PADDLE_H * 0.25f) - (y < lcenter - PADDLE_H * 0.25f);
+        rdir[i] = (y > rcenter + PADDLE_H * 0.25f) - (y < rcenter - PADDLE_H * 0.25f);
+    }
+}
+
+static void step_kernel(
+        int n,
+        float delta_time,
+        float* __restrict ball_x,
+        float* __restrict ball_y,
+        float* __restrict vel_x,
+        float* __restrict vel_y,
+        int*   __restrict lpad,
+        int*   __restrict rpad,
+        float* __restrict remainder_l,
+        float* __restrict remainder_r,
+        int const* __restrict ldir,
+        int const* __restrict rdir) {
+
+    for (int i = 0; i < n; i++) {
+        // update_paddles()
+        float flr_dis = (ldir[i] * PADSPEED) * delta_time + remainder_l[i];
+        float frr_dis = (rdir[i] * PADSPEED) * delta_time + remainder_r[i];
+
+        // floor() without a libm call, exact while the value fits an int
+        int lr_dis = (int) flr_dis;
+        int rr_dis = (int) frr_dis;
+        lr_dis -= flr_dis < lr_dis;
+        rr_dis -= frr_dis < rr_dis;
+
+        remainder_r[i] = frr_dis - rr_dis;
+        remainder_l[i] = flr_dis - lr_dis;
+
+        int lpp = lpad[i];
+        int rpp = rpad[i];
+        lr_dis *= !((lpp + lr_dis + 5 < 0) | (lpp + lr_dis > HEIGHT - PADDLE_H + 5));
+        rr_dis *= !((rpp + rr_dis + 5 < 0) | (rpp + rr_dis > HEIGHT - PADDLE_H + 5));
+
+        lpp += lr_dis;
+        rpp += rr_dis;
+        lpad[i] = lpp;
+        rpad[i] = rpp;
+
+        // update_ball()
+        float x  = ball_x[i];
+        float y  = ball_y[i];
+        float vx = vel_x[i];
+        float vy = vel_y[i];
+
+        move_ball(x, y, vx, vy, lpp, rpp, delta_time);
+
+        ball_x[i] = x;
+        ball_y[i] = y;
+        vel_x[i]  = vx;
+        vel_y[i]  = vy;
+    }
+}
+
+void match_batch_bot_input(MatchBatch* batch, int begin, int end) {
+    bot_input_kernel(end - begin,
+        batch->ball_y + begin, batch->lpad + begin, batch->rpad + begin,
+        batch->ldir + begin, batch->rdir + begin);
+}
+
+int match_batch_reset_scored(MatchBatch* batch, int begin, int end) {
+    Game fresh;
+    reset(&fresh);
+
+    // Rare, a plain loop is enough
+    int count = 0;
+    for (int i = begin; i < end; i++) {
+        if (batch->ball_x[i] + BALL_W >= 0 && batch->ball_x[i] <= WIDTH) continue;
+        match_batch_set(batch, i, &fresh);
+        count++;
+    }
+    return count;
+}
+
+void match_batch_step(MatchBatch* batch, int begin, int end, float delta_time) {
+    step_kernel(end - begin, delta_time,
+        batch->ball_x + begin, batch->ball_y + begin,
+        batch->vel_x + begin, batch->vel_y + begin,
+        batch->lpad + begin, batch->rpad + begin,
+        batch->remainder_l + begin, batch->remainder_r + begin,
+        batch->ldir + begin, batch->rdir + begin);
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include "game.h"
+
+/// Many independent matches stored as a struct of arrays, so a single
+/// loop steps all of them and the compiler can vectorize it.
+/// Stepping a match here gives bit-identical results to step() on a Game.
+struct MatchBatch {
+    int count;
+
+    // Ball
+    float* ball_x;
+    float* ball_y;
+    float* vel_x;
+    float* vel_y;
+
+    // Paddles
+    int*   lpad;
+    int*   rpad;
+    float* remainder_l;
+    float* remainder_r;
+
+    // Input of the next step
+    int*   ldir;
+    int*   rdir;
+};
+
+/// Allocate the arrays for count matches and reset every match
+/// @returns 0 on success
+int match_batch_init(MatchBatch* batch, int count);
+void match_batch_free(MatchBatch* batch);
+
+/// Copy a match in or out of the batch
+void match_batch_set(MatchBatch* batch, int i, Game const* game);
+Game match_batch_get(MatchBatch const* batch, int i);
+
+/// Fill the input of the matches [begin, end) with bot_input()
+void match_batch_bot_input(MatchBatch* batch, int begin, int end);
+
+/**
+ * Step the matches [begin, end) by one update with their current input.
+ * Restart input is not supported, reset a match with match_batch_set().
+ */
+void match_batch_step(MatchBatch* batch, int begin, int end, float delta_time);
+
+/**
+ * Reset the matches in [begin, end) that scored(), like a bot match
+ * stepped with step() does.
+ * @returns Matches reset
+ */
+int match_batch_reset_scored(MatchBatch* batch, int begin, int end);
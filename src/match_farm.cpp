@@ -0,0 +1,173 @@
+#include "match_farm.h"
+
+#include <time.h>
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+/// Monotonic time in seconds
+static double now() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+struct Task {
+    int begin;
+    int end;
+};
+
+// Every worker has its own cache lines, so they don't slow each other down
+struct alignas(64) WorkerQueue {
+    std::mutex          lock;
+    std::deque<Task>    tasks;
+};
+
+struct alignas(64) WorkerStats {
+    double  busy;   // Seconds spent stepping matches
+    long    tasks;
+    long    steals;
+};
+
+/// State shared by the coordinator and the workers
+struct Farm {
+    MatchBatch*     batch;
+    float           delta_time;
+    int             threads;
+    WorkerQueue     queues[FARM_MAX_THREADS];
+
+    std::mutex              lock;
+    std::condition_variable round_start;
+    std::condition_variable round_done;
+    long    round;          // Incremented when a round is dealt
+    int     round_ticks;    // Ticks of the current round
+    int     running;        // Workers not done with the current round
+    bool    quit;
+
+    WorkerStats stats[FARM_MAX_THREADS];
+};
+
+/// Own tasks come from the front, so the chunks a worker was dealt run
+/// in order, and thieves take the last ones
+static bool pop_own(WorkerQueue* queue, Task* task) {
+    std::lock_guard<std::mutex> guard(queue->lock);
+    if (queue->tasks.empty()) return false;
+    *task = queue->tasks.front();
+    queue->tasks.pop_front();
+    return true;
+}
+
+static bool steal(WorkerQueue* queue, Task* task) {
+    std::lock_guard<std::mutex> guard(queue->lock);
+    if (queue->tasks.empty()) return false;
+    *task = queue->tasks.back();
+    queue->tasks.pop_back();
+    return true;
+}
+
+static void run_task(Farm* farm, Task task, int ticks) {
+    for (int t = 0; t < ticks; t++) {
+        match_batch_bot_input(farm->batch, task.begin, task.end);
+        match_batch_step(farm->batch, task.begin, task.end, farm->delta_time);
+        match_batch_reset_scored(farm->batch, task.begin, task.end);
+    }
+}
+
+static void worker(Farm* farm, int id) {
+    long seen = 0; // Last round this worker took part in
+    for (;;) {
+        int ticks;
+        {
+            std::unique_lock<std::mutex> guard(farm->lock);
+            farm->round_start.wait(guard, [&] { return farm->quit || farm->round != seen; });
+            if (farm->quit) return;
+            seen  = farm->round;
+            ticks = farm->round_ticks;
+        }
+
+        // All the tasks are dealt before the round starts, so once every
+        // queue is empty there is nothing left to do in this round
+        double start = now();
+        Task task;
+        for (;;) {
+            if (pop_own(&farm->queues[id], &task)) {
+                run_task(farm, task, ticks);
+                farm->stats[id].tasks++;
+                continue;
+            }
+
+            bool stolen = false;
+            for (int i = 1; i < farm->threads && !stolen; i++) {
+                stolen = steal(&farm->queues[(id + i) % farm->threads], &task);
+            }
+            if (!stolen) break;
+
+            run_task(farm, task, ticks);
+            farm->stats[id].tasks++;
+            farm->stats[id].steals++;
+        }
+        farm->stats[id].busy += now() - start;
+
+        std::lock_guard<std::mutex> guard(farm->lock);
+        if (--farm->running == 0) farm->round_done.notify_one();
+    }
+}
+
+int farm_run(MatchBatch* batch, FarmConfig const* config, long ticks, float delta_time, FarmReport* report) {
+    if (config->threads < 1 || config->threads > FARM_MAX_THREADS
+        || config->chunk < 1 || config->round_ticks < 1) {
+        return -1;
+    }
+
+    Farm* farm = new Farm();
+    farm->batch         = batch;
+    farm->delta_time    = delta_time;
+    farm->threads       = config->threads;
+    farm->round         = 0;
+    farm->running       = 0;
+    farm->quit          = false;
+
+    std::thread workers[FARM_MAX_THREADS];
+    for (int i = 0; i < farm->threads; i++) workers[i] = std::thread(worker, farm, i);
+
+    double start = now();
+    for (long done = 0; done < ticks; done += config->round_ticks) {
+        // Deal the chunks round robin, the stealing evens out the rest
+        int task = 0;
+        for (int begin = 0; begin < batch->count; begin += config->chunk, task++) {
+            int end = begin + config->chunk < batch->count ? begin + config->chunk : batch->count;
+            WorkerQueue* queue = &farm->queues[task % farm->threads];
+            std::lock_guard<std::mutex> guard(queue->lock);
+            queue->tasks.push_back({ begin, end });
+        }
+
+        std::unique_lock<std::mutex> guard(farm->lock);
+        farm->round_ticks   = ticks - done < config->round_ticks ? (int) (ticks - done) : config->round_ticks;
+        farm->running       = farm->threads;
+        farm->round++;
+        farm->round_start.notify_all();
+        farm->round_done.wait(guard, [&] { return farm->running == 0; });
+    }
+    double elapsed = now() - start;
+
+    {
+        std::lock_guard<std::mutex> guard(farm->lock);
+        farm->quit = true;
+        farm->round_start.notify_all();
+    }
+    for (int i = 0; i < farm->threads; i++) workers[i].join();
+
+    *report = {0};
+    report->seconds                 = elapsed;
+    report->match_ticks_per_second  = (double) ticks * batch->count / elapsed;
+    for (int i = 0; i < farm->threads; i++) {
+        report->utilization[i]  = farm->stats[i].busy / elapsed;
+        report->tasks          += farm->stats[i].tasks;
+        report->steals         += farm->stats[i].steals;
+    }
+
+    delete farm;
+    return 0;
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include "match_batch.h"
+
+constexpr int FARM_MAX_THREADS = 64;
+
+struct FarmConfig {
+    int threads;        // Worker threads
+    int chunk;          // Matches in a task
+    int round_ticks;    // Ticks a task steps its matches before the work is dealt again
+};
+
+struct FarmReport {
+    double seconds;                                 // Wall time of the whole run
+    double match_ticks_per_second;                  // Ticks of all the matches together
+    double utilization[FARM_MAX_THREADS];           // Share of the run every worker was stepping matches
+    long   tasks;                                   // Tasks run
+    long   steals;                                  // Tasks a worker took from another one's queue
+};
+
+/**
+ * Step every match of the batch with bot input on a pool of threads.
+ * The matches are cut into chunks, which are dealt to per-worker
+ * queues every round. A worker runs its own queue from the back and,
+ * when it is empty, steals from the front of the others. Matches don't
+ * depend on each other, so the result is bit-identical to stepping the
+ * batch on a single thread.
+ * @returns 0 on success
+ */
+int farm_run(MatchBatch* batch, FarmConfig const* config, long ticks, float delta_time, FarmReport* report);
@@ -0,0 +1,140 @@
+#include "renderer.h"
+
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+
+static float BG_COLOR[] = {0.2f, 0.2f, 0.2f, 1.0f};
+
+static glm::vec3 const WHITE = { 1.0f, 1.0f, 1.0f };
+
+constexpr unsigned char ALL_REGIONS = (1 << STREAM_REGIONS) - 1;
+
+/// Point the instance attributes at a region of the instance buffer,
+/// with the VAO and the buffer bound
+static void point_instances(long base) {
+    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(Instance), (void*) (base + offsetof(Instance, pos)));
+    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Instance), (void*) (base + offsetof(Instance, size)));
+    glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, sizeof(Instance), (void*) (base + offsetof(Instance, color)));
+}
+
+int renderer_init(Renderer* renderer, GLuint program) {
+    glGenVertexArrays(1, &renderer->vao);
+    glGenBuffers(1, &renderer->quad);
+    glGenBuffers(1, &renderer->ebo);
+
+    glBindVertexArray(renderer->vao);
+
+    // Unit quad, scaled and moved by every instance
+    glm::vec2 corners[] = {
+        { 0.0f, 0.0f },
+        { 0.0f, 1.0f },
+        { 1.0f, 1.0f },
+        { 1.0f, 0.0f },
+    };
+    GLuint indicies[] = {
+        0, 1, 2,
+        2, 3, 0,
+    };
+
+    glBindBuffer(GL_ARRAY_BUFFER, renderer->quad);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(corners), corners, GL_STATIC_DRAW);
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(glm::vec2), (void*) 0);
+    glEnableVertexAttribArray(0);
+
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, renderer->ebo);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indicies), indicies, GL_STATIC_DRAW);
+
+    // Attributes advancing once per instance
+    if (stream_buffer_init(&renderer->instances, GL_ARRAY_BUFFER, sizeof(Instance) * MAX_INSTANCES)) {
+        glBindVertexArray(0);
+        return -1;
+    }
+    point_instances(0);
+
+    // Nothing is uploaded to any region yet
+    renderer->count = 0;
+    memset(renderer->shadow, 0, sizeof(renderer->shadow));
+    memset(renderer->stale, ALL_REGIONS, sizeof(renderer->stale));
+
+    for (GLuint attr = 1; attr <= 3; attr++) {
+        glEnableVertexAttribArray(attr);
+        glVertexAttribDivisor(attr, 1);
+    }
+
+    glBindVertexArray(0);
+
+    return renderer_use_program(renderer, program);
+}
+
+int renderer_use_program(Renderer* renderer, GLuint program) {
+    // The field is drawn in pixels, the shader maps them to the clip space
+    GLint window = glGetUniformLocation(program, "uWindow");
+    if (window < 0) {
+        fputs("ERROR:RENDERER:NO_UNIFORM uWindow\n", stderr);
+        return -1;
+    }
+    renderer->window = window;
+    glUseProgram(program);
+    glUniform2f(renderer->window, WIDTH, HEIGHT);
+
+    return 0;
+}
+
+int gen_instances(RenderState const* state, Instance* instances) {
+    // Left paddle
+    instances[0] = { { PADDING, state->lpad },                      { PADDLE_W, PADDLE_H }, WHITE };
+    // Right paddle
+    instances[1] = { { WIDTH - PADDING - PADDLE_W, state->rpad },   { PADDLE_W, PADDLE_H }, WHITE };
+    // Ball
+    instances[2] = { state->ball,                                   { BALL_W, BALL_H },     WHITE };
+    return 3;
+}
+
+bool renderer_upload(Renderer* renderer, Instance const* instances, int count) {
+    bool changed = count != renderer->count;
+    for (int i = 0; i < count; i++) {
+        if (!memcmp(&renderer->shadow[i], &instances[i], sizeof(Instance))) continue;
+        renderer->shadow[i] = instances[i];
+        renderer->stale[i]  = ALL_REGIONS;
+        changed = true;
+    }
+    renderer->count = count;
+
+    // The last region still holds exactly this frame
+    if (!changed) return false;
+
+    StreamBuffer* buffer = &renderer->instances;
+    long base = stream_buffer_begin(buffer);
+
+    // An orphaned region starts out empty, a persistent one only misses
+    // what changed since the last time it was used
+    unsigned char bit = buffer->persistent ? 1 << buffer->region : 0;
+    for (int i = 0; i < count; ) {
+        if (bit && !(renderer->stale[i] & bit)) { i++; continue; }
+
+        int begin = i;
+        while (i < count && (!bit || renderer->stale[i] & bit)) renderer->stale[i++] &= ~bit;
+        stream_buffer_write(buffer, sizeof(Instance) * begin, &renderer->shadow[begin], sizeof(Instance) * (i - begin));
+    }
+
+    glBindVertexArray(renderer->vao);
+    point_instances(base);
+    glBindVertexArray(0);
+    return true;
+}
+
+void render(Renderer* renderer, int count, GpuTimer* timer) {
+    gpu_timer_begin(timer, GPU_CLEAR);
+    glClearColor(BG_COLOR[0], BG_COLOR[1], BG_COLOR[2], BG_COLOR[3]);
+    glClear(GL_COLOR_BUFFER_BIT);
+    gpu_timer_end(timer, GPU_CLEAR);
+
+    gpu_timer_begin(timer, GPU_DRAW);
+    glBindVertexArray(renderer->vao);
+    glDrawElementsInstanced(GL_TRIANGLES, 6, GL_UNSIGNED_INT, nullptr, count);
+    gpu_timer_end(timer, GPU_DRAW);
+
+    // The GPU is done with the region of this frame once the draw is
+    stream_buffer_end(&renderer->instances);
+}
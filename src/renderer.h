@@ -0,0 +1,63 @@
+#pragma once
+
+#include <GL/glew.h>
+
+#include <glm/vec2.hpp>
+#include <glm/vec3.hpp>
+
+#include "game.h"
+#include "gpu_timer.h"
+#include "stream_buffer.h"
+
+constexpr int MAX_INSTANCES = 4096; // Rectangles drawn in a single frame at most
+
+/// A rectangle on the screen. The vertex shader turns it into clip
+/// coordinates, so the CPU never generates verticies.
+struct Instance {
+    glm::vec2 pos;      // Top left pixel
+    glm::vec2 size;     // Size in pixels
+    glm::vec3 color;
+};
+
+struct Renderer {
+    GLuint vao;
+    GLuint quad;        // Corners of the unit quad shared by all the instances
+    GLuint ebo;
+    StreamBuffer instances; // Per instance attributes, rewritten every frame
+    GLint  window;      // Location of the uWindow uniform
+
+    // Dirty tracking
+    int           count;                    // Instances uploaded last
+    Instance      shadow[MAX_INSTANCES];    // Copy of the instances uploaded last
+    unsigned char stale[MAX_INSTANCES];     // Bit per stream buffer region the instance is out of date in
+};
+
+/**
+ * Create the buffers and the vertex layout.
+ * @param program Linked shader program the renderer draws with
+ * @returns 0 on success
+ */
+int renderer_init(Renderer* renderer, GLuint program);
+
+/**
+ * Draw with program from now on and set up its uniforms.
+ * @returns 0 on success, the previous program stays in use otherwise
+ */
+int renderer_use_program(Renderer* renderer, GLuint program);
+
+/**
+ * Fill instances with the paddles and the ball.
+ * @returns Instances written
+ */
+int gen_instances(RenderState const* state, Instance* instances);
+
+/**
+ * Upload the instances of this frame through the stream buffer. Only
+ * the ranges of instances that changed are written.
+ * @returns If anything changed since the last upload, so the frame needs drawing
+ */
+bool renderer_upload(Renderer* renderer, Instance const* instances, int count);
+
+/// Clear the screen and draw count uploaded instances with a single call
+/// @param timer Times the clear and the draw on the GPU
+void render(Renderer* renderer, int count, GpuTimer* timer);
@@ -0,0 +1,298 @@
+#include "replay.h"
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+constexpr int MAX_RECORD = 64; // Bytes of the longest record
+
+struct Recorder {
+    int      fd;
+    char     buffer[REPLAY_BUFFER];
+    int      used;
+    uint64_t ticks;         // Recorded
+    int      run_input;     // Tag of the run not written yet, -1 if none
+    uint64_t run;           // Its ticks
+    Game     keyframe;      // The last one, the next is stored relative to it
+    uint64_t keyframe_tick;
+
+    std::thread             syncer;
+    std::mutex              lock;
+    std::condition_variable wake;
+    bool     dirty;         // Written since the last sync
+    bool     quit;
+};
+
+static uint8_t input_tag(Input input) {
+    return (input.ldir + 1) | (input.rdir + 1) << 2 | (input.should_restart ? 1 << 4 : 0);
+}
+
+static Input tag_input(uint8_t tag) {
+    Input input = {0};
+    input.ldir           = (tag & 3) - 1;
+    input.rdir           = (tag >> 2 & 3) - 1;
+    input.should_restart = tag >> 4 & 1;
+    return input;
+}
+
+static char* put_u32(char* out, uint32_t value) {
+    for (int i = 0; i < 4; i++) *out++ = (char) (value >> 8 * i);
+    return out;
+}
+
+static char const* get_u32(char const* in, uint32_t* value) {
+    *value = 0;
+    for (int i = 0; i < 4; i++) *value |= (uint32_t) (uint8_t) *in++ << 8 * i;
+    return in;
+}
+
+static char* put_varint(char* out, uint64_t value) {
+    while (value >= 0x80) {
+        *out++ = (char) (value | 0x80);
+        value >>= 7;
+    }
+    *out++ = (char) value;
+    return out;
+}
+
+/// @returns Past the varint, nullptr if it doesn't end before end
+static char const* get_varint(char const* in, char const* end, uint64_t* value) {
+    *value = 0;
+    for (int shift = 0; in < end && shift < 64; shift += 7) {
+        uint8_t byte = *in++;
+        *value |= (uint64_t) (byte & 0x7f) << shift;
+        if (!(byte & 0x80)) return in;
+    }
+    return nullptr;
+}
+
+static uint64_t zigzag(int64_t value) { return (uint64_t) (value << 1) ^ (uint64_t) (value >> 63); }
+static int64_t unzigzag(uint64_t value) { return (int64_t) (value >> 1) ^ -(int64_t) (value & 1); }
+
+static uint32_t bits(float value) {
+    uint32_t out;
+    memcpy(&out, &value, sizeof(out));
+    return out;
+}
+
+static float from_bits(uint32_t value) {
+    float out;
+    memcpy(&out, &value, sizeof(out));
+    return out;
+}
+
+/// The floats of a keyframe, in the order they are stored
+static void game_floats(Game const* game, uint32_t out[6]) {
+    out[0] = bits(game->remainder_l);
+    out[1] = bits(game->remainder_r);
+    out[2] = bits(game->ball.pos.x);
+    out[3] = bits(game->ball.pos.y);
+    out[4] = bits(game->ball.vel.x);
+    out[5] = bits(game->ball.vel.y);
+}
+
+static void write_buffer(Recorder* recorder) {
+    char const* data = recorder->buffer;
+    int left = recorder->used;
+    while (left > 0) {
+        ssize_t written = write(recorder->fd, data, left);
+        if (written < 0) {
+            perror("ERROR:REPLAY:WRITE");
+            break;
+        }
+        data += written;
+        left -= written;
+    }
+    recorder->used = 0;
+
+    std::lock_guard<std::mutex> guard(recorder->lock);
+    recorder->dirty = true;
+    recorder->wake.notify_one();
+}
+
+/// Syncs whatever was written since it last did, the writes in between pile up
+static void sync_loop(Recorder* recorder) {
+    std::unique_lock<std::mutex> guard(recorder->lock);
+    for (;;) {
+        recorder->wake.wait(guard, [&] { return recorder->dirty || recorder->quit; });
+        if (!recorder->dirty) return;
+        recorder->dirty = false;
+
+        guard.unlock();
+        if (fdatasync(recorder->fd)) perror("ERROR:REPLAY:SYNC");
+        guard.lock();
+    }
+}
+
+static void flush_run(Recorder* recorder) {
+    if (recorder->run_input < 0) return;
+
+    char* out = recorder->buffer + recorder->used;
+    *out++ = (char) recorder->run_input;
+    out = put_varint(out, recorder->run);
+    recorder->used = out - recorder->buffer;
+    recorder->run_input = -1;
+}
+
+static void put_keyframe(Recorder* recorder, Game const* game) {
+    uint32_t curr[6], last[6];
+    game_floats(game, curr);
+    game_floats(&recorder->keyframe, last);
+
+    char* out = recorder->buffer + recorder->used;
+    *out++ = (char) REPLAY_KEYFRAME;
+    out = put_varint(out, recorder->ticks - recorder->keyframe_tick);
+    out = put_varint(out, zigzag((int64_t) game->lpad - recorder->keyframe.lpad));
+    out = put_varint(out, zigzag((int64_t) game->rpad - recorder->keyframe.rpad));
+    for (int i = 0; i < 6; i++) out = put_varint(out, curr[i] ^ last[i]);
+    recorder->used = out - recorder->buffer;
+
+    recorder->keyframe      = *game;
+    recorder->keyframe_tick = recorder->ticks;
+}
+
+Recorder* recorder_open(char const* path, int tick_rate) {
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        fprintf(stderr, "ERROR:REPLAY:OPEN %s\n", path);
+        return nullptr;
+    }
+
+    Recorder* recorder = new Recorder();
+    recorder->fd        = fd;
+    recorder->run_input = -1;
+    recorder->keyframe  = {};
+
+    char* out = recorder->buffer;
+    memcpy(out, REPLAY_MAGIC, sizeof(REPLAY_MAGIC));
+    out = put_u32(out + sizeof(REPLAY_MAGIC), REPLAY_VERSION);
+    out = put_u32(out, tick_rate);
+    out = put_u32(out, 0);
+    recorder->used = out - recorder->buffer;
+
+    recorder->syncer = std::thread(sync_loop, recorder);
+    return recorder;
+}
+
+void recorder_tick(Recorder* recorder, Game const* game, Input input) {
+    // Room for a run and a keyframe
+    if (recorder->used + 2 * MAX_RECORD > REPLAY_BUFFER) write_buffer(recorder);
+
+    if (recorder->ticks % REPLAY_KEYFRAME_TICKS == 0) {
+        flush_run(recorder);
+        put_keyframe(recorder, game);
+        write_buffer(recorder);
+    }
+
+    uint8_t tag = input_tag(input);
+    if (tag != recorder->run_input) {
+        flush_run(recorder);
+        recorder->run_input = tag;
+        recorder->run       = 0;
+    }
+    recorder->run++;
+    recorder->ticks++;
+}
+
+void record_tick(void* recorder, Game const* game, Input input) {
+    recorder_tick((Recorder*) recorder, game, input);
+}
+
+void recorder_close(Recorder* recorder) {
+    flush_run(recorder);
+    write_buffer(recorder);
+    {
+        std::lock_guard<std::mutex> guard(recorder->lock);
+        recorder->quit = true;
+        recorder->wake.notify_one();
+    }
+    recorder->syncer.join();
+    close(recorder->fd);
+    delete recorder;
+}
+
+static bool same_game(Game const* a, Game const* b) {
+    uint32_t fa[6], fb[6];
+    game_floats(a, fa);
+    game_floats(b, fb);
+    return a->lpad == b->lpad && a->rpad == b->rpad && !memcmp(fa, fb, sizeof(fa));
+}
+
+int replay_play(char const* data, long size, ReplayReport* report) {
+    *report = {};
+
+    ReplayHeader header;
+    if (size < REPLAY_HEADER) return -1;
+    memcpy(header.magic, data, sizeof(header.magic));
+    char const* in = get_u32(data + sizeof(header.magic), &header.version);
+    in = get_u32(in, &header.tick_rate);
+    in = get_u32(in, &header.reserved);
+    if (memcmp(header.magic, REPLAY_MAGIC, sizeof(header.magic)) || header.version != REPLAY_VERSION
+        || header.tick_rate == 0) {
+        return -1;
+    }
+    report->tick_rate = header.tick_rate;
+
+    // The very same delta time the recording ran with
+    FixedStep clock;
+    fixed_step_init(&clock, header.tick_rate);
+
+    Game game = {}, prev, keyframe = {};
+    uint64_t keyframe_tick = 0;
+    char const* end = data + size;
+    while (in < end) {
+        uint8_t tag = *in++;
+        uint64_t value;
+
+        if (tag != REPLAY_KEYFRAME) {
+            // No direction is 3, nothing else fits in the input bits
+            if (tag >> 5 || (tag & 3) == 3 || (tag >> 2 & 3) == 3) {
+                report->corrupt    = true;
+                report->corrupt_at = in - 1 - data;
+                break;
+            }
+            if (!(in = get_varint(in, end, &value))) break;
+            for (uint64_t t = 0; t < value; t++) {
+                Input input = tag_input(tag);
+                run_tick(&prev, &game, &input, clock.delta_time);
+            }
+            report->ticks += value;
+            continue;
+        }
+
+        uint64_t fields[9];
+        for (uint64_t& field : fields) {
+            if (!(in = get_varint(in, end, &field))) break;
+        }
+        if (!in) break;
+
+        uint32_t floats[6];
+        game_floats(&keyframe, floats);
+        keyframe.lpad += (int) unzigzag(fields[1]);
+        keyframe.rpad += (int) unzigzag(fields[2]);
+        keyframe.remainder_l = from_bits(floats[0] ^ (uint32_t) fields[3]);
+        keyframe.remainder_r = from_bits(floats[1] ^ (uint32_t) fields[4]);
+        keyframe.ball.pos.x  = from_bits(floats[2] ^ (uint32_t) fields[5]);
+        keyframe.ball.pos.y  = from_bits(floats[3] ^ (uint32_t) fields[6]);
+        keyframe.ball.vel.x  = from_bits(floats[4] ^ (uint32_t) fields[7]);
+        keyframe.ball.vel.y  = from_bits(floats[5] ^ (uint32_t) fields[8]);
+
+        // The first one is where the match starts
+        bool reached = same_game(&game, &keyframe) && fields[0] == report->ticks - keyframe_tick;
+        if (report->keyframes && !reached) {
+            if (!report->mismatches) report->first_mismatch = report->ticks;
+            report->mismatches++;
+        }
+        game          = keyframe;
+        keyframe_tick = report->ticks;
+        report->keyframes++;
+    }
+    report->truncated = !report->corrupt && in != end;
+    report->game      = game;
+    return 0;
+}
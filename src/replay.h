@@ -0,0 +1,70 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "game.h"
+
+// Layout of a replay, all little endian, only ever appended to so it can
+// be played while it is still recorded:
+//   ReplayHeader, REPLAY_HEADER bytes: the magic, then the other fields
+//              as 32 bit integers
+//   records up to the end of the file, each starting with a tag byte:
+//     input    a run of ticks with the same input, the tag is the input
+//              (ldir + 1 | rdir + 1 << 2 | should_restart << 4), then a
+//              varint of the ticks
+//     REPLAY_KEYFRAME
+//              the state before the next tick, every REPLAY_KEYFRAME_TICKS
+//              ticks starting with the first: varint of the ticks since the
+//              last keyframe, the paddles as zigzag varints of the change,
+//              the floats as varints of their bits xored with the last ones
+constexpr char     REPLAY_MAGIC[4]       = { 'P', 'R', 'E', 'P' };
+constexpr uint32_t REPLAY_VERSION        = 1;
+constexpr uint8_t  REPLAY_KEYFRAME       = 0x80;
+constexpr int      REPLAY_KEYFRAME_TICKS = 256;
+constexpr int      REPLAY_BUFFER         = 4096;   // Bytes written at once at most
+constexpr int      REPLAY_HEADER         = 16;     // Bytes of the header in the file
+
+/// Read and written a field at a time, whatever the byte order of the host
+struct ReplayHeader {
+    char     magic[4];
+    uint32_t version;
+    uint32_t tick_rate;
+    uint32_t reserved;
+};
+
+/// Records the ticks of a match. Writes batched up to every keyframe,
+/// a thread of its own syncs them to disk, so recording never waits
+/// for the disk.
+struct Recorder;
+
+/// @returns nullptr if path can't be created
+Recorder* recorder_open(char const* path, int tick_rate);
+
+/// Record a tick that starts from game and runs with input
+void recorder_tick(Recorder* recorder, Game const* game, Input input);
+
+/// For InputStream::on_tick, with the recorder as the user
+void record_tick(void* recorder, Game const* game, Input input);
+
+/// Write what's left, sync and close
+void recorder_close(Recorder* recorder);
+
+struct ReplayReport {
+    int      tick_rate;
+    uint64_t ticks;         // Played
+    long     keyframes;
+    long     mismatches;    // Keyframes the playback didn't reach bit-exactly
+    uint64_t first_mismatch; // Tick of the first one
+    bool     truncated;     // Ends in a partial record, like one still being written
+    bool     corrupt;       // Stopped at a record with an unknown tag
+    long     corrupt_at;    // Its offset in the data
+    Game     game;          // After the last tick
+};
+
+/**
+ * Play a replay on the fixed-step simulation as fast as possible,
+ * checking the state at every keyframe. A mismatch carries on from the
+ * keyframe.
+ * @returns 0 on success, -1 if data is no replay
+ */
+int replay_play(char const* data, long size, ReplayReport* report);
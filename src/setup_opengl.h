@@ -3,9 +3,9 @@
 #include <GL/glew.h>
 #include <GLFW/glfw3.h>
 
+#include "game.h"
+
 /// Window properties
-constexpr int WIDTH         = 800;
-constexpr int HEIGHT        = 450;
 constexpr char const* TITLE = "Sample text";
 
 int setup_opengl(GLFWwindow*& window);
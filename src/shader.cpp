@@ -0,0 +1,213 @@
+#include "shader.h"
+
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "util/pack.h"
+
+// Cache entry: ProgramCacheHeader followed by the binary
+constexpr char     CACHE_MAGIC[4] = { 'P', 'S', 'H', 'B' };
+constexpr uint32_t CACHE_VERSION  = 1;
+
+struct ProgramCacheHeader {
+    char     magic[4];
+    uint32_t version;
+    uint64_t key;       // Of the sources and the driver
+    uint64_t checksum;  // Of the binary, catches torn writes
+    uint32_t format;    // Binary format the driver reported
+    uint32_t size;      // Bytes of the binary
+};
+
+GLuint compile_shader(const char *const source, GLint length, GLuint type) {
+    GLuint shader = glCreateShader(type);
+    glShaderSource(shader, 1, &source, &length);
+    glCompileShader(shader);
+
+    int success;
+    glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
+
+    if (!success) {
+        char error_desc[512];
+        glGetShaderInfoLog(shader, 512, nullptr, error_desc);
+        fprintf(stderr, "ERROR:SHADER:COMPILE %s\n", error_desc);
+        fprintf(stderr, "%.*s\n", length, source);
+
+        glDeleteShader(shader);
+        return 0;
+    }
+
+    return shader;
+}
+
+/// Hash a GL string, a missing one counts as empty
+static uint64_t hash_gl_string(GLenum name, uint64_t hash) {
+    char const* s = (char const*) glGetString(name);
+    if (!s) s = "";
+    return pack_hash(s, strlen(s) + 1, hash);
+}
+
+/// Cache key: the sources and everything that identifies the driver.
+/// GL_VERSION carries the driver version on the common drivers.
+static uint64_t program_key(FileView const* vertex, FileView const* fragment) {
+    uint64_t key = pack_hash(vertex->data, vertex->size);
+    key = pack_hash((char const*) &vertex->size, sizeof(vertex->size), key);
+    key = pack_hash(fragment->data, fragment->size, key);
+    key = hash_gl_string(GL_VENDOR, key);
+    key = hash_gl_string(GL_RENDERER, key);
+    key = hash_gl_string(GL_VERSION, key);
+    return key;
+}
+
+/**
+ * Path of the cache entry: $XDG_CACHE_HOME/pong/<name>.bin, or
+ * ~/.cache/pong/<name>.bin. Creates the directories.
+ * @returns 0 on success
+ */
+static int cache_path(char const* name, char* path, int capacity) {
+    char const* xdg  = getenv("XDG_CACHE_HOME");
+    char const* home = getenv("HOME");
+
+    int bytes;
+    if (xdg && xdg[0] == '/')   bytes = snprintf(path, capacity, "%s/pong", xdg);
+    else if (home && home[0])   bytes = snprintf(path, capacity, "%s/.cache/pong", home);
+    else                        return -1;
+    if (bytes < 0 || bytes >= capacity) return -1;
+
+    // Create every missing directory of the path
+    for (char* c = path + 1; ; c++) {
+        if (*c != '/' && *c) continue;
+        char end = *c;
+        *c = 0;
+        int status = mkdir(path, 0755);
+        *c = end;
+        if (status && errno != EEXIST) return -1;
+        if (!end) break;
+    }
+
+    int rest = snprintf(path + bytes, capacity - bytes, "/%s.bin", name);
+    return rest < 0 || rest >= capacity - bytes ? -1 : 0;
+}
+
+static bool binaries_supported() {
+    if (!GLEW_ARB_get_program_binary) return false;
+    GLint formats = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+    return formats > 0;
+}
+
+/// @returns The program of the cache entry, 0 if it is missing, stale or rejected
+static GLuint load_cached(char const* path, uint64_t key) {
+    FileView file;
+    if (access(path, R_OK) || map_file(path, &file)) return 0;
+
+    GLuint program = 0;
+    ProgramCacheHeader const* header = (ProgramCacheHeader const*) file.data;
+    char const* binary = file.data + sizeof(ProgramCacheHeader);
+
+    if (file.size >= (long) sizeof(ProgramCacheHeader)
+        && !memcmp(header->magic, CACHE_MAGIC, sizeof(CACHE_MAGIC))
+        && header->version == CACHE_VERSION
+        && header->key == key
+        && header->size == file.size - sizeof(ProgramCacheHeader)
+        && header->checksum == pack_hash(binary, header->size)) {
+        program = glCreateProgram();
+        glProgramBinary(program, header->format, binary, header->size);
+
+        // Drivers reject binaries of other versions here too
+        GLint success;
+        glGetProgramiv(program, GL_LINK_STATUS, &success);
+        if (!success) {
+            glDeleteProgram(program);
+            program = 0;
+        }
+    }
+
+    release_file(&file);
+    return program;
+}
+
+/// Write the entry to a temporary file and rename it over the old one,
+/// so a crash never leaves a torn entry behind
+static void store_cached(char const* path, uint64_t key, GLuint program) {
+    GLint size = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &size);
+    if (size <= 0) return;
+
+    char* binary = (char*) malloc(size);
+    if (!binary) return;
+
+    GLenum format;
+    glGetProgramBinary(program, size, &size, &format, binary);
+
+    ProgramCacheHeader header = {0};
+    memcpy(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC));
+    header.version  = CACHE_VERSION;
+    header.key      = key;
+    header.checksum = pack_hash(binary, size);
+    header.format   = format;
+    header.size     = size;
+
+    char temp[600];
+    snprintf(temp, sizeof(temp), "%s.%d", path, (int) getpid());
+
+    FILE* out = fopen(temp, "wb");
+    bool written = out
+        && fwrite(&header, sizeof(header), 1, out) == 1
+        && fwrite(binary, 1, size, out) == (size_t) size;
+    if (out && fclose(out)) written = false;
+
+    if (!written || rename(temp, path)) {
+        fprintf(stderr, "ERROR:SHADER:CACHE_WRITE %s\n", path);
+        unlink(temp);
+    }
+    free(binary);
+}
+
+GLuint build_program(char const* name, FileView const* vertex, FileView const* fragment) {
+    char path[512];
+    bool cache  = binaries_supported() && !cache_path(name, path, sizeof(path));
+    uint64_t key = program_key(vertex, fragment);
+
+    if (cache) {
+        GLuint program = load_cached(path, key);
+        if (program) return program;
+    }
+
+    GLuint shv = compile_shader(vertex->data, vertex->size, GL_VERTEX_SHADER);
+    GLuint shf = compile_shader(fragment->data, fragment->size, GL_FRAGMENT_SHADER);
+    if (!shv || !shf) {
+        glDeleteShader(shv);
+        glDeleteShader(shf);
+        return 0;
+    }
+
+    GLuint program = glCreateProgram();
+    if (cache) glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    glAttachShader(program, shv);
+    glAttachShader(program, shf);
+    glLinkProgram(program);
+
+    // The program keeps what it needs
+    glDetachShader(program, shv);
+    glDetachShader(program, shf);
+    glDeleteShader(shv);
+    glDeleteShader(shf);
+
+    int success;
+    glGetProgramiv(program, GL_LINK_STATUS, &success);
+    if (!success) {
+        char infoLog[512];
+        glGetProgramInfoLog(program, 512, nullptr, infoLog);
+        fprintf(stderr, "ERROR:SHADER:LINK %s\n", infoLog);
+        glDeleteProgram(program);
+        return 0;
+    }
+
+    if (cache) store_cached(path, key, program);
+    return program;
+}
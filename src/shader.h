@@ -0,0 +1,24 @@
+#pragma once
+
+#include <GL/glew.h>
+
+#include "util/file.h"
+
+// Sources of the program everything is drawn with
+constexpr char const* DEFAULT_VERTEX   = "shader/default.vert";
+constexpr char const* DEFAULT_FRAGMENT = "shader/default.frag";
+
+/**
+ * @returns The compiled shader, 0 on error
+ */
+GLuint compile_shader(const char *const source, GLint length, GLuint type);
+
+/**
+ * Compile and link a program, or load it from the program binary cache
+ * when the sources and the driver are the same as last time. Programs
+ * compiled anew are stored in the cache, entries that don't match are
+ * replaced.
+ * @param name Of the cache entry, like "default"
+ * @returns The linked program, 0 on error
+ */
+GLuint build_program(char const* name, FileView const* vertex, FileView const* fragment);
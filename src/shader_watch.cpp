@@ -0,0 +1,158 @@
+#include "shader_watch.h"
+
+#include <poll.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <thread>
+
+#include "shader.h"
+#include "util/file.h"
+
+constexpr int SETTLE_MS = 50; // Editors write in bursts, wait until they're done
+
+struct ShaderWatch {
+    GLFWwindow*         context;    // Hidden, shares objects with the window
+    int                 inotify;
+    int                 wake;       // eventfd, set to stop the thread
+    std::thread         thread;
+    std::atomic<GLuint> program;    // Built and not taken yet
+};
+
+/// Read the inotify events waiting
+/// @returns If any of them is about a shader source
+static bool drain(int fd) {
+    alignas(inotify_event) char buffer[4096];
+    bool shader = false;
+
+    ssize_t n;
+    while ((n = read(fd, buffer, sizeof(buffer))) > 0) {
+        for (char* at = buffer; at < buffer + n; ) {
+            inotify_event* event = (inotify_event*) at;
+            at += sizeof(inotify_event) + event->len;
+
+            if (!event->len) continue;
+            char const* dot = strrchr(event->name, '.');
+            shader |= dot && (!strcmp(dot, ".vert") || !strcmp(dot, ".frag"));
+        }
+    }
+    return shader;
+}
+
+static GLuint rebuild() {
+    FileView vertex, fragment;
+    if (get_resource(DEFAULT_VERTEX, &vertex)) return 0;
+    if (get_resource(DEFAULT_FRAGMENT, &fragment)) {
+        release_file(&vertex);
+        return 0;
+    }
+
+    GLuint program = build_program("default", &vertex, &fragment);
+
+    release_file(&vertex);
+    release_file(&fragment);
+    return program;
+}
+
+static void watch_thread(ShaderWatch* watch) {
+    glfwMakeContextCurrent(watch->context);
+
+    pollfd fds[2] = {
+        { watch->inotify, POLLIN, 0 },
+        { watch->wake,    POLLIN, 0 },
+    };
+
+    for (;;) {
+        if (poll(fds, 2, -1) < 0) continue;
+        if (fds[1].revents) break;
+        if (!drain(watch->inotify)) continue;
+
+        // Until the directory is quiet
+        while (poll(fds, 1, SETTLE_MS) > 0) drain(watch->inotify);
+
+        GLuint program = rebuild();
+        if (!program) {
+            fputs("ERROR:SHADER:RELOAD keeping the old program\n", stderr);
+            continue;
+        }
+
+        // Everything the other context uses has to be done
+        glFinish();
+
+        GLuint stale = watch->program.exchange(program);
+        if (stale) glDeleteProgram(stale);
+        fputs("Shaders reloaded\n", stderr);
+
+        // The render thread picks it up within a tick, even idle
+    }
+
+    glfwMakeContextCurrent(nullptr);
+}
+
+ShaderWatch* shader_watch_start(GLFWwindow* window) {
+    if (!RESOURCE.BYTES) return nullptr;
+
+    char dir[sizeof(RESOURCE.DIR) + 8];
+    snprintf(dir, sizeof(dir), "%sshader", RESOURCE.DIR);
+
+    int inotify = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (inotify < 0) return nullptr;
+
+    // Editors either write in place or rename a new file over the old one
+    if (inotify_add_watch(inotify, dir, IN_CLOSE_WRITE | IN_MOVED_TO) < 0) {
+        fprintf(stderr, "ERROR:SHADER:WATCH %s\n", dir);
+        close(inotify);
+        return nullptr;
+    }
+
+    int wake = eventfd(0, EFD_CLOEXEC);
+    if (wake < 0) {
+        close(inotify);
+        return nullptr;
+    }
+
+    // Windows can only be created on the main thread
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    GLFWwindow* context = glfwCreateWindow(1, 1, "", nullptr, window);
+    glfwDefaultWindowHints();
+    if (!context) {
+        close(inotify);
+        close(wake);
+        return nullptr;
+    }
+
+    ShaderWatch* watcher = new ShaderWatch();
+    watcher->context = context;
+    watcher->inotify = inotify;
+    watcher->wake    = wake;
+    watcher->program = 0;
+    watcher->thread  = std::thread(watch_thread, watcher);
+    return watcher;
+}
+
+void shader_watch_stop(ShaderWatch* watch) {
+    if (!watch) return;
+
+    uint64_t one = 1;
+    if (write(watch->wake, &one, sizeof(one)) != sizeof(one)) fputs("ERROR:SHADER:WATCH_STOP\n", stderr);
+    watch->thread.join();
+
+    // Objects are shared, the window's context can delete it
+    GLuint program = watch->program.exchange(0);
+    if (program) glDeleteProgram(program);
+
+    glfwDestroyWindow(watch->context);
+    close(watch->inotify);
+    close(watch->wake);
+    delete watch;
+}
+
+GLuint shader_watch_take(ShaderWatch* watch) {
+    if (!watch) return 0;
+    return watch->program.exchange(0);
+}
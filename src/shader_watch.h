@@ -0,0 +1,27 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <GLFW/glfw3.h>
+
+/// Rebuilds the default program whenever its sources in the resource
+/// directory change. A thread blocks on inotify and compiles on a hidden
+/// context shared with the window, the render loop only picks up the
+/// finished program.
+struct ShaderWatch;
+
+/**
+ * Call on the main thread, after the window is set up.
+ * @returns null if there's nothing to watch, as the resources don't
+ *          come from a directory, or inotify isn't available
+ */
+ShaderWatch* shader_watch_start(GLFWwindow* window);
+
+/// Stop the thread and drop a program not taken yet. Main thread only.
+void shader_watch_stop(ShaderWatch* watch);
+
+/**
+ * Never blocks, an atomic exchange.
+ * @returns The program built since the last call, 0 if none. The
+ *          caller owns it.
+ */
+GLuint shader_watch_take(ShaderWatch* watch);
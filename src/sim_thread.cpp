@@ -0,0 +1,130 @@
+#include "sim_thread.h"
+
+#include <string.h>
+#include <time.h>
+
+#include <thread>
+
+#include "util/profiler.h"
+
+struct SimThread {
+    FixedStep           clock;
+    InputStream         input;
+    Game                prev;
+    Game                curr;
+    uint64_t            (*timer)();
+    std::atomic<bool>   quit;
+    std::thread         thread;
+    TripleBuffer        snapshots;
+
+    // Sliding window of the events taken, copied into every snapshot
+    InputEvent          taken[INPUT_TAKEN];
+    uint64_t            taken_at[INPUT_TAKEN];
+    int                 taken_count;
+};
+
+void triple_buffer_init(TripleBuffer* buffer, Snapshot const* initial) {
+    for (Snapshot& slot : buffer->slots) slot = *initial;
+    buffer->back  = 0;
+    buffer->middle.store(1);
+    buffer->front = 2;
+}
+
+/// Add the events the last advance() took to the window, dropping the oldest
+static void remember_taken(SimThread* sim, uint64_t now) {
+    for (int i = 0; i < sim->input.taken_count; i++) {
+        if (sim->taken_count == INPUT_TAKEN) {
+            memmove(sim->taken, sim->taken + 1, sizeof(InputEvent) * (INPUT_TAKEN - 1));
+            memmove(sim->taken_at, sim->taken_at + 1, sizeof(uint64_t) * (INPUT_TAKEN - 1));
+            sim->taken_count--;
+        }
+        sim->taken[sim->taken_count]    = sim->input.taken[i];
+        sim->taken_at[sim->taken_count] = now;
+        sim->taken_count++;
+    }
+}
+
+static void publish(SimThread* sim, uint64_t now) {
+    Snapshot* s     = triple_buffer_back(&sim->snapshots);
+    s->prev         = sim->prev;
+    s->curr         = sim->curr;
+    s->input        = sim->input.input;
+    s->time         = now;
+    s->accumulator  = sim->clock.accumulator;
+    s->tick         = sim->clock.tick;
+    s->frequency    = sim->clock.frequency;
+    s->ticks        = sim->clock.ticks;
+    s->taken_count  = sim->taken_count;
+    memcpy(s->taken, sim->taken, sizeof(InputEvent) * sim->taken_count);
+    memcpy(s->taken_at, sim->taken_at, sizeof(uint64_t) * sim->taken_count);
+    triple_buffer_publish(&sim->snapshots);
+}
+
+static void run(SimThread* sim) {
+    ProfileTrack* track = PROFILER_ENABLED ? profiler_track("Simulation") : nullptr;
+
+    while (!sim->quit.load(std::memory_order_relaxed)) {
+        uint64_t start = PROFILER_ENABLED ? profiler_now() : 0;
+        uint64_t now   = sim->timer();
+        int ran = advance(&sim->clock, &sim->prev, &sim->curr, &sim->input, now);
+        remember_taken(sim, now);
+        if (ran || sim->input.taken_count) publish(sim, now);
+        if (PROFILER_ENABLED && ran) profiler_record_track(track, "advance", start, profiler_now());
+
+        // Until the next tick is due. Paused, only to look at the input.
+        double wait = sim->input.input.pause ? sim->clock.tick : sim->clock.tick - sim->clock.accumulator;
+        if (wait > 0) {
+            timespec ts = { 0, (long) (wait * 1e9) };
+            nanosleep(&ts, nullptr);
+        }
+    }
+}
+
+SimThread* sim_start(int tick_rate, InputQueue* queue, uint64_t now, uint64_t frequency, uint64_t (*timer)(),
+                     Recorder* recorder) {
+    SimThread* sim = new SimThread();
+    fixed_step_init(&sim->clock, tick_rate);
+    fixed_step_start(&sim->clock, now, frequency);
+    sim->input       = {};
+    sim->input.queue = queue;
+    if (recorder) {
+        sim->input.on_tick = record_tick;
+        sim->input.user    = recorder;
+    }
+    sim->timer       = timer;
+    sim->taken_count = 0;
+    sim->quit        = false;
+
+    reset(&sim->curr);
+    sim->prev = sim->curr;
+
+    Snapshot initial = {};
+    initial.prev      = sim->prev;
+    initial.curr      = sim->curr;
+    initial.time      = now;
+    initial.tick      = sim->clock.tick;
+    initial.frequency = frequency;
+    triple_buffer_init(&sim->snapshots, &initial);
+
+    sim->thread = std::thread(run, sim);
+    return sim;
+}
+
+void sim_stop(SimThread* sim) {
+    sim->quit = true;
+    sim->thread.join();
+    delete sim;
+}
+
+Snapshot const* sim_latest(SimThread* sim) {
+    return triple_buffer_read(&sim->snapshots);
+}
+
+float snapshot_alpha(Snapshot const* snapshot, uint64_t now) {
+    if (snapshot->input.pause) return 1.0f;
+
+    // The simulation runs behind by the accumulator, and real time went on since
+    double since = now > snapshot->time ? (double) (now - snapshot->time) / snapshot->frequency : 0;
+    double alpha = (snapshot->accumulator + since) / snapshot->tick;
+    return alpha < 1.0 ? (float) alpha : 1.0f;
+}
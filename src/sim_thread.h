@@ -0,0 +1,85 @@
+#pragma once
+
+#include <stdint.h>
+
+#include <atomic>
+
+#include "game.h"
+#include "replay.h"
+
+/// What the simulation hands to the renderer after every tick. Never
+/// changed once published.
+struct Snapshot {
+    Game     prev;          // Before the last tick
+    Game     curr;          // After it
+    Input    input;         // Input of the last tick, tells if paused
+    uint64_t time;          // Timer value the snapshot was taken at
+    double   accumulator;   // Real time not simulated at that point, in seconds
+    double   tick;          // Duration of a tick in seconds
+    uint64_t frequency;     // Timer values in a second
+    uint64_t ticks;         // Ticks simulated since the start
+
+    // The latest events the ticks applied and when, newest last, for
+    // latency tracking. A reader that falls behind by more misses some.
+    InputEvent taken[INPUT_TAKEN];
+    uint64_t   taken_at[INPUT_TAKEN];
+    int        taken_count;
+};
+
+/// Lock-free triple buffer: the writer always has a slot to fill, the
+/// reader always has the newest complete one, neither ever waits. The
+/// third slot is swapped between them through an atomic index.
+struct TripleBuffer {
+    Snapshot slots[3];
+    alignas(64) std::atomic<uint8_t> middle;   // Slot in between, TRIPLE_FRESH set if not read yet
+    alignas(64) uint8_t back;                  // Slot the writer fills, writer only
+    alignas(64) uint8_t front;                 // Slot the reader holds, reader only
+};
+
+constexpr uint8_t TRIPLE_FRESH = 4;
+
+void triple_buffer_init(TripleBuffer* buffer, Snapshot const* initial);
+
+/// Writer: the slot to fill, publish it with triple_buffer_publish()
+inline Snapshot* triple_buffer_back(TripleBuffer* buffer) {
+    return &buffer->slots[buffer->back];
+}
+
+/// Writer: make the back slot the newest and take the middle one as back
+inline void triple_buffer_publish(TripleBuffer* buffer) {
+    uint8_t old = buffer->middle.exchange(buffer->back | TRIPLE_FRESH, std::memory_order_acq_rel);
+    buffer->back = old & ~TRIPLE_FRESH;
+}
+
+/// Reader: the newest snapshot, valid until the next call
+inline Snapshot const* triple_buffer_read(TripleBuffer* buffer) {
+    if (buffer->middle.load(std::memory_order_relaxed) & TRIPLE_FRESH) {
+        uint8_t old = buffer->middle.exchange(buffer->front, std::memory_order_acq_rel);
+        buffer->front = old & ~TRIPLE_FRESH;
+    }
+    return &buffer->slots[buffer->front];
+}
+
+/// The simulation on its own thread, ticking at a fixed rate whatever
+/// the display does, taking input from the event queue. The render
+/// thread reads its snapshots, the main thread fills the queue.
+struct SimThread;
+
+/**
+ * Start ticking a fresh match.
+ * @param queue Key events, the simulation thread becomes their consumer
+ * @param now Timer value, like glfwGetTimerValue(), the clock starts at
+ * @param frequency Timer values in a second
+ * @param timer Reads the timer, callable from any thread
+ * @param recorder Gets every tick if not null, close it after sim_stop()
+ */
+SimThread* sim_start(int tick_rate, InputQueue* queue, uint64_t now, uint64_t frequency, uint64_t (*timer)(),
+                     Recorder* recorder);
+
+void sim_stop(SimThread* sim);
+
+/// Newest snapshot, never blocks. Valid until the next call, render thread only.
+Snapshot const* sim_latest(SimThread* sim);
+
+/// How far the real time at now is between prev and curr, in [0, 1]
+float snapshot_alpha(Snapshot const* snapshot, uint64_t now);
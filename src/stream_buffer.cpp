@@ -0,0 +1,87 @@
+#include "stream_buffer.h"
+
+#include <stdio.h>
+#include <string.h>
+
+constexpr GLuint64 FENCE_TIMEOUT = 1000000000; // One second in nanoseconds
+
+int stream_buffer_init(StreamBuffer* buffer, GLenum target, int region_size) {
+    *buffer = {0};
+    buffer->target      = target;
+    buffer->region_size = region_size;
+    buffer->persistent  = GLEW_ARB_buffer_storage;
+
+    glGenBuffers(1, &buffer->handle);
+    glBindBuffer(target, buffer->handle);
+
+    if (!buffer->persistent) {
+        glBufferData(target, region_size, nullptr, GL_STREAM_DRAW);
+        return 0;
+    }
+
+    GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    GLsizeiptr size  = (GLsizeiptr) region_size * STREAM_REGIONS;
+    glBufferStorage(target, size, nullptr, flags);
+    buffer->mapped = (char*) glMapBufferRange(target, 0, size, flags);
+    if (!buffer->mapped) {
+        fputs("ERROR:STREAM_BUFFER:MAP\n", stderr);
+        glDeleteBuffers(1, &buffer->handle);
+        return -1;
+    }
+    return 0;
+}
+
+void stream_buffer_free(StreamBuffer* buffer) {
+    for (GLsync fence : buffer->fences) {
+        if (fence) glDeleteSync(fence);
+    }
+    if (buffer->mapped) {
+        glBindBuffer(buffer->target, buffer->handle);
+        glUnmapBuffer(buffer->target);
+    }
+    glDeleteBuffers(1, &buffer->handle);
+    *buffer = {0};
+}
+
+long stream_buffer_begin(StreamBuffer* buffer) {
+    glBindBuffer(buffer->target, buffer->handle);
+
+    if (!buffer->persistent) {
+        // Orphan: the driver hands out fresh storage while the GPU keeps
+        // reading the old one
+        glBufferData(buffer->target, buffer->region_size, nullptr, GL_STREAM_DRAW);
+        return 0;
+    }
+
+    buffer->region = (buffer->region + 1) % STREAM_REGIONS;
+
+    GLsync& fence = buffer->fences[buffer->region];
+    if (fence) {
+        // Usually signaled long ago, as the region was used frames back
+        GLenum wait = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, FENCE_TIMEOUT);
+        while (wait == GL_TIMEOUT_EXPIRED) wait = glClientWaitSync(fence, 0, FENCE_TIMEOUT);
+        if (wait == GL_WAIT_FAILED) fputs("ERROR:STREAM_BUFFER:WAIT\n", stderr);
+
+        glDeleteSync(fence);
+        fence = nullptr;
+    }
+    return (long) buffer->region * buffer->region_size;
+}
+
+void stream_buffer_write(StreamBuffer* buffer, int offset, void const* data, int bytes) {
+    if (!buffer->persistent) {
+        glBindBuffer(buffer->target, buffer->handle);
+        glBufferSubData(buffer->target, offset, bytes, data);
+        return;
+    }
+    memcpy(buffer->mapped + (long) buffer->region * buffer->region_size + offset, data, bytes);
+}
+
+void stream_buffer_end(StreamBuffer* buffer) {
+    if (!buffer->persistent) return;
+
+    // Frames that didn't write anything draw from the same region again
+    GLsync& fence = buffer->fences[buffer->region];
+    if (fence) glDeleteSync(fence);
+    fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <GL/glew.h>
+
+constexpr int STREAM_REGIONS = 3; // Frames in flight a stream buffer holds
+
+/// Buffer for data rewritten every frame. With ARB_buffer_storage it is
+/// mapped once, persistently and coherently, and split into regions the
+/// frames take turns on, each guarded by a fence, so the CPU never
+/// writes what the GPU still reads and the driver never has to sync
+/// implicitly. Without the extension every frame orphans the buffer.
+struct StreamBuffer {
+    GLuint  handle;
+    GLenum  target;
+    int     region_size;                // Bytes of a region
+    int     region;                     // Region of the current frame
+    bool    persistent;                 // Mapped with ARB_buffer_storage
+    char*   mapped;                     // Start of the mapping, if persistent
+    GLsync  fences[STREAM_REGIONS];     // Set when the GPU is done with a region
+};
+
+/**
+ * @param target Binding target, like GL_ARRAY_BUFFER
+ * @param region_size Most bytes written in a frame
+ * @returns 0 on success
+ */
+int stream_buffer_init(StreamBuffer* buffer, GLenum target, int region_size);
+void stream_buffer_free(StreamBuffer* buffer);
+
+/**
+ * Start a frame: wait until the GPU is done with the next region and bind
+ * the buffer. Orphaned regions start out empty, persistent ones keep
+ * what was written STREAM_REGIONS frames ago.
+ * @returns Offset of the region within the buffer, to point attributes at
+ */
+long stream_buffer_begin(StreamBuffer* buffer);
+
+/// Copy data to offset bytes into the region of the current frame
+void stream_buffer_write(StreamBuffer* buffer, int offset, void const* data, int bytes);
+
+/// Finish the frame. Call after the commands that read the region were
+/// issued, also in frames that reuse the region without a begin.
+void stream_buffer_end(StreamBuffer* buffer);
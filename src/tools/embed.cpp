@@ -0,0 +1,40 @@
+// Turn a file into C++ source, like xxd -i: build/embed <in> <out.cpp> <symbol>
+// Defines the bytes as symbol[] and their count as symbol_SIZE. The
+// array is 16 byte aligned and zero terminated past the size.
+#include <stdio.h>
+
+#include "../util/file.h"
+
+int main(int argc, char** argv) {
+    if (argc != 4) {
+        fputs("Usage: embed <in> <out.cpp> <symbol>\n", stderr);
+        return -1;
+    }
+    char const* symbol = argv[3];
+
+    FileView view;
+    if (map_file(argv[1], &view)) return -1;
+
+    FILE* out = fopen(argv[2], "w");
+    if (!out) {
+        fprintf(stderr, "ERROR:EMBED:OPEN %s\n", argv[2]);
+        release_file(&view);
+        return -1;
+    }
+
+    fprintf(out, "// Generated from %s, don't edit\n\n", argv[1]);
+    fprintf(out, "alignas(16) extern constexpr unsigned char %s[] = {", symbol);
+    for (long i = 0; i < view.size; i++) {
+        if (i % 16 == 0) fputs("\n   ", out);
+        fprintf(out, " 0x%02x,", (unsigned char) view.data[i]);
+    }
+    fprintf(out, "\n    0x00\n};\n\n");
+    fprintf(out, "extern constexpr long %s_SIZE = %ld;\n", symbol, view.size);
+
+    release_file(&view);
+    if (fclose(out)) {
+        fprintf(stderr, "ERROR:EMBED:WRITE %s\n", argv[2]);
+        return -1;
+    }
+    return 0;
+}
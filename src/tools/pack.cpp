@@ -0,0 +1,148 @@
+// Offline packer: build/pack [-c] <out.pack> <resource_dir>
+// Every regular file under the directory becomes an entry named by its
+// path relative to the directory, like "shader/default.vert".
+#include <dirent.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "../util/file.h"
+#include "../util/lz4.h"
+#include "../util/pack.h"
+
+struct Input {
+    std::string name;   // Relative to the resource directory
+    std::string path;   // To open
+    uint64_t    hash;
+};
+
+/// Collect the regular files under dir, depth first
+static int walk(std::string const& dir, std::string const& prefix, std::vector<Input>* inputs) {
+    DIR* d = opendir(dir.c_str());
+    if (!d) {
+        fprintf(stderr, "ERROR:PACK:OPENDIR %s\n", dir.c_str());
+        return -1;
+    }
+
+    int status = 0;
+    while (dirent* e = readdir(d)) {
+        if (!strcmp(e->d_name, ".") || !strcmp(e->d_name, "..")) continue;
+
+        std::string path = dir + "/" + e->d_name;
+        std::string name = prefix + e->d_name;
+
+        struct stat st;
+        if (stat(path.c_str(), &st)) continue;
+
+        if (S_ISDIR(st.st_mode)) status |= walk(path, name + "/", inputs);
+        else if (S_ISREG(st.st_mode)) inputs->push_back({ name, path, pack_hash(name.data(), name.size()) });
+    }
+    closedir(d);
+    return status;
+}
+
+static void pad(FILE* out, long* at) {
+    while (*at % PACK_ALIGN) {
+        fputc(0, out);
+        (*at)++;
+    }
+}
+
+int main(int argc, char** argv) {
+    bool compress = argc > 1 && !strcmp(argv[1], "-c");
+    if (argc != 3 + compress) {
+        fputs("Usage: pack [-c] <out.pack> <resource_dir>\n", stderr);
+        return -1;
+    }
+    char const* out_path = argv[1 + compress];
+    std::string dir      = argv[2 + compress];
+    while (dir.size() > 1 && dir.back() == '/') dir.pop_back();
+
+    std::vector<Input> inputs;
+    if (walk(dir, "", &inputs)) return -1;
+
+    std::sort(inputs.begin(), inputs.end(), [](Input const& a, Input const& b) {
+        return a.hash != b.hash ? a.hash < b.hash : a.name < b.name;
+    });
+
+    PackHeader header = {0};
+    memcpy(header.magic, PACK_MAGIC, sizeof(PACK_MAGIC));
+    header.version = PACK_VERSION;
+    header.count   = inputs.size();
+
+    std::vector<PackEntry> entries(inputs.size());
+    std::string names;
+    for (size_t i = 0; i < inputs.size(); i++) {
+        entries[i].hash         = inputs[i].hash;
+        entries[i].name_offset  = names.size();
+        entries[i].name_size    = inputs[i].name.size();
+        names += inputs[i].name;
+    }
+    header.names_size = names.size();
+
+    FILE* out = fopen(out_path, "wb");
+    if (!out) {
+        fprintf(stderr, "ERROR:PACK:OPEN %s\n", out_path);
+        return -1;
+    }
+
+    // The index is written last, once the offsets are known
+    long at = sizeof(PackHeader) + entries.size() * sizeof(PackEntry) + names.size();
+    fseek(out, at, SEEK_SET);
+    pad(out, &at);
+
+    long total_in  = 0;
+    long total_out = 0;
+    for (size_t i = 0; i < inputs.size(); i++) {
+        FileView view;
+        if (map_file(inputs[i].path.c_str(), &view)) {
+            fclose(out);
+            return -1;
+        }
+
+        char const* blob = view.data;
+        long size        = view.size;
+        std::vector<unsigned char> packed;
+
+        if (compress) {
+            packed.resize(lz4_bound(view.size));
+            long packed_size = lz4_compress((unsigned char const*) view.data, view.size, packed.data(), packed.size());
+
+            // Stored as is unless it pays off
+            if (packed_size >= 0 && packed_size < view.size) {
+                blob = (char const*) packed.data();
+                size = packed_size;
+                entries[i].flags |= PACK_LZ4;
+            }
+        }
+
+        entries[i].offset        = at;
+        entries[i].size          = size;
+        entries[i].original_size = view.size;
+        fwrite(blob, 1, size, out);
+        at += size;
+        pad(out, &at);
+
+        printf("%-32s %8ld -> %8ld\n", inputs[i].name.c_str(), view.size, size);
+        total_in  += view.size;
+        total_out += size;
+        release_file(&view);
+    }
+
+    fseek(out, 0, SEEK_SET);
+    fwrite(&header, sizeof(header), 1, out);
+    fwrite(entries.data(), sizeof(PackEntry), entries.size(), out);
+    fwrite(names.data(), 1, names.size(), out);
+
+    if (fclose(out)) {
+        fprintf(stderr, "ERROR:PACK:WRITE %s\n", out_path);
+        return -1;
+    }
+    printf("%zu entries, %ld -> %ld bytes\n", inputs.size(), total_in, total_out);
+    return 0;
+}
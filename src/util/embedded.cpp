@@ -0,0 +1,15 @@
+#include "file.h"
+
+#ifdef EMBED_RESOURCES
+// Pack of resource/ generated by 'make EMBED=1'
+extern unsigned char const EMBEDDED_PACK[];
+extern long const EMBEDDED_PACK_SIZE;
+
+int mount_embedded() {
+    return mount_pack_memory((char const*) EMBEDDED_PACK, EMBEDDED_PACK_SIZE);
+}
+#else
+int mount_embedded() {
+    return -1;
+}
+#endif
@@ -1,37 +1,129 @@
 #include "file.h"
 
+#include <fcntl.h>
+#include <stdlib.h>
 #include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
+#include "pack.h"
 
-int source_file(FILE * __restrict file, char* __restrict ptr, int & n) {
-    n = 0;
-    int c;
-    while ( (c = fgetc(file)) && c != EOF ) {
-        ptr[n++] = c;
+Resource RESOURCE;
+
+static Pack PACK;       // Mounted pack
+static bool PACKED;     // If the resources come from PACK
+
+/// Read until the end of the file, for files without a known size
+static int read_file(int fd, FileView* view) {
+    long capacity = 4096;
+    long size     = 0;
+    char* data    = (char*) malloc(capacity);
+    if (!data) return -1;
+
+    for (;;) {
+        if (size == capacity) {
+            capacity *= 2;
+            char* grown = (char*) realloc(data, capacity);
+            if (!grown) {
+                free(data);
+                return -1;
+            }
+            data = grown;
+        }
+
+        ssize_t n = read(fd, data + size, capacity - size);
+        if (n < 0) {
+            free(data);
+            return -1;
+        }
+        if (n == 0) break;
+        size += n;
     }
-    // Zero temrminate
-    ptr[n] = 0;
+
+    view->data = data;
+    view->size = size;
+    view->map  = nullptr;
     return 0;
 }
 
-int get_resource(char const* __restrict path, char* __restrict source, int & n) {
-    int bytes = strlen(path);
-    memcpy(RESOURCE.DIR + RESOURCE.BYTES, path, bytes);
+int map_file(char const* path, FileView* view) {
+    *view = {0};
 
-    // Source file
-    FILE* sfile = fopen(RESOURCE.DIR, "r");
-    if (!sfile) {
-        fprintf(stderr, "Couldn't read the file: %s\n", RESOURCE.DIR);
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        fprintf(stderr, "Couldn't read the file: %s\n", path);
         return -1;
     }
-    int status = source_file(sfile, source, n);
 
-    // Failed to read the file
-    if (status) {
-        fprintf(stderr, "Couldn't get the resource: %s\n", RESOURCE.DIR);
+    struct stat st;
+    int status = fstat(fd, &st);
+    if (!status && S_ISREG(st.st_mode) && st.st_size > 0) {
+        void* map = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (map != MAP_FAILED) {
+            view->data = (char const*) map;
+            view->size = st.st_size;
+            view->map  = map;
+            close(fd);
+            return 0;
+        }
     }
 
-    fclose(sfile);
-    RESOURCE.DIR[RESOURCE.BYTES] = 0;
+    // Not a regular file or can't be mapped
+    status = read_file(fd, view);
+    if (status) fprintf(stderr, "Couldn't get the resource: %s\n", path);
+
+    close(fd);
+    return status;
+}
+
+void release_file(FileView* view) {
+    if (view->borrowed) {}
+    else if (view->map)  munmap(view->map, view->size);
+    else            free((void*) view->data);
+    *view = {0};
+}
+
+int mount_pack(char const* path) {
+    if (PACKED) pack_close(&PACK);
+    PACKED = false;
+
+    int status = pack_open(path, &PACK);
+    if (status) return status;
+    PACKED = true;
+    return 0;
+}
+
+int mount_pack_memory(char const* data, long size) {
+    if (PACKED) pack_close(&PACK);
+    PACKED = false;
+
+    int status = pack_open_memory(data, size, &PACK);
+    if (status) return status;
+    PACKED = true;
+    return 0;
+}
+
+int get_resource(char const* __restrict path, FileView* view) {
+    if (PACKED) {
+        PackEntry const* entry = pack_find(&PACK, path);
+        if (!entry) {
+            *view = {0};
+            fprintf(stderr, "Couldn't get the resource: %s\n", path);
+            return -1;
+        }
+        return pack_read(&PACK, entry, view);
+    }
+
+    int bytes = strlen(path);
+
+    // Directory and path, on the heap so any length works
+    char* full = (char*) malloc(RESOURCE.BYTES + bytes + 1);
+    if (!full) return -1;
+    memcpy(full, RESOURCE.DIR, RESOURCE.BYTES);
+    memcpy(full + RESOURCE.BYTES, path, bytes + 1);
+
+    int status = map_file(full, view);
+    free(full);
     return status;
 }
@@ -7,21 +7,52 @@
 // - Ha ha static go brrr
 struct Resource {
     char DIR[512];  // resource/ directory
-    int  BYTES;     // Bytes used to store the directory name including the 0 terminator
+    int  BYTES;     // Bytes used to store the directory name excluding the 0 terminator
 };
 
 // The resources. Access only from 'main.cpp'
 // and 'file.cpp'
 extern Resource RESOURCE;
 
-/// Read the content of the file to ptr.
-/// @param n bytes written
-/// @returns The read status
-int source_file(FILE * file, char* ptr, int & n);
+/// Read-only view of a whole file. Mapped straight from the page cache
+/// when possible, so reading it copies nothing. Not zero terminated.
+struct FileView {
+    char const* data;
+    long        size;
+    void*       map;    // Start of the mapping, null if data was read to the heap
+    bool        borrowed; // Points into memory owned by something else, like a pack
+};
+
+/**
+ * Map the file, or read it in one go if it can't be mapped (pipes,
+ * procfs). Any size works.
+ * @returns The read status
+ */
+int map_file(char const* path, FileView* view);
+
+/// Unmap or free the view
+void release_file(FileView* view);
+
+/**
+ * Serve the resources from a pack built by the packer instead of the
+ * resource directory. The pack stays mapped until the process exits.
+ * @returns 0 on success
+ */
+int mount_pack(char const* path);
+
+/// Like mount_pack(), for a pack already in memory that outlives the process
+int mount_pack_memory(char const* data, long size);
+
+/**
+ * Serve the resources built into the binary with 'make EMBED=1'
+ * straight from .rodata, without touching the filesystem.
+ * @returns 0 on success, -1 if the binary has none
+ */
+int mount_embedded();
 
 /**
- *  @param path to the resource
- *  @param bytes bytes of path
- *  @param n elements read
+ *  @param path to the resource, relative to the resource directory,
+ *         or its name in the mounted pack
+ *  @param view Receives the content, release with release_file()
  */
-int get_resource(char const* path, char* source, int & n);
+int get_resource(char const* path, FileView* view);
@@ -0,0 +1,114 @@
+#include "loader.h"
+
+#include <string.h>
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct Load {
+    std::string     path;
+    LoadCallback    callback;
+    void*           user;
+    int             status;
+    FileView        view;
+};
+
+struct Loader {
+    std::vector<std::thread> workers;
+
+    std::mutex              lock;
+    std::condition_variable queued;     // A request came in or the loader stops
+    std::condition_variable finished;   // A completion came in
+    std::deque<Load>        requests;
+    std::deque<Load>        completions;
+    int     pending;    // Requested and not polled yet
+    bool    quit;
+};
+
+static void worker(Loader* loader) {
+    for (;;) {
+        Load load;
+        {
+            std::unique_lock<std::mutex> guard(loader->lock);
+            loader->queued.wait(guard, [&] { return loader->quit || !loader->requests.empty(); });
+            if (loader->requests.empty()) return;
+            load = std::move(loader->requests.front());
+            loader->requests.pop_front();
+        }
+
+        load.status = get_resource(load.path.c_str(), &load.view);
+
+        std::lock_guard<std::mutex> guard(loader->lock);
+        loader->completions.push_back(std::move(load));
+        loader->finished.notify_one();
+    }
+}
+
+Loader* loader_create(int threads) {
+    Loader* loader  = new Loader();
+    loader->pending = 0;
+    loader->quit    = false;
+    for (int i = 0; i < threads; i++) loader->workers.emplace_back(worker, loader);
+    return loader;
+}
+
+void loader_destroy(Loader* loader) {
+    {
+        std::lock_guard<std::mutex> guard(loader->lock);
+        loader->quit = true;
+        loader->queued.notify_all();
+    }
+    // The workers finish the queue before they return
+    for (std::thread& t : loader->workers) t.join();
+
+    for (Load& load : loader->completions) release_file(&load.view);
+    delete loader;
+}
+
+int load_async(Loader* loader, char const* path, LoadCallback callback, void* user) {
+    std::lock_guard<std::mutex> guard(loader->lock);
+    if (loader->quit || loader->workers.empty()) return -1;
+
+    Load load;
+    load.path     = path;
+    load.callback = callback;
+    load.user     = user;
+    load.status   = 0;
+    load.view     = {0};
+    loader->requests.push_back(std::move(load));
+    loader->pending++;
+    loader->queued.notify_one();
+    return 0;
+}
+
+/// Take the finished loads, then run their callbacks without the lock
+static int run_completions(Loader* loader, std::unique_lock<std::mutex>& guard) {
+    std::deque<Load> done;
+    done.swap(loader->completions);
+    loader->pending -= done.size();
+    guard.unlock();
+
+    for (Load& load : done) load.callback(load.path.c_str(), load.status, &load.view, load.user);
+
+    guard.lock();
+    return done.size();
+}
+
+int loader_poll(Loader* loader) {
+    std::unique_lock<std::mutex> guard(loader->lock);
+    return run_completions(loader, guard);
+}
+
+int loader_wait(Loader* loader) {
+    int ran = 0;
+    std::unique_lock<std::mutex> guard(loader->lock);
+    while (loader->pending > 0) {
+        loader->finished.wait(guard, [&] { return !loader->completions.empty(); });
+        ran += run_completions(loader, guard);
+    }
+    return ran;
+}
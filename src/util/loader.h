@@ -0,0 +1,40 @@
+#pragma once
+
+#include "file.h"
+
+/**
+ * Called on the thread that polls the loader once a load is done.
+ * @param status Of get_resource(), view is empty unless it is 0
+ * @param view Owned by the callback, release it with release_file()
+ */
+typedef void (*LoadCallback)(char const* path, int status, FileView* view, void* user);
+
+/// Resources read by worker threads. Finished loads queue up until the
+/// owner polls, so the callbacks, and any GL calls in them, run on the
+/// owner's thread.
+struct Loader;
+
+/// @param threads Workers reading in parallel
+Loader* loader_create(int threads);
+
+/// Wait for the loads in flight, drop their completions and stop the workers
+void loader_destroy(Loader* loader);
+
+/**
+ * Queue a get_resource() of path.
+ * @param path Copied, doesn't have to outlive the call
+ * @returns 0 on success
+ */
+int load_async(Loader* loader, char const* path, LoadCallback callback, void* user);
+
+/**
+ * Run the callbacks of the loads finished so far. Never blocks.
+ * @returns Callbacks run
+ */
+int loader_poll(Loader* loader);
+
+/**
+ * Run callbacks as loads finish until none are left.
+ * @returns Callbacks run
+ */
+int loader_wait(Loader* loader);
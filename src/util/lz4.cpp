@@ -0,0 +1,132 @@
+#include "lz4.h"
+
+#include <string.h>
+#include <stdint.h>
+
+// Format constants of the LZ4 block format
+constexpr int MIN_MATCH     = 4;
+constexpr int LAST_LITERALS = 5;    // The last bytes are always literals
+constexpr int MF_LIMIT      = 12;   // No match starts this close to the end
+constexpr int MAX_OFFSET    = 65535;
+constexpr int HASH_BITS     = 12;
+
+static uint32_t read32(unsigned char const* p) {
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static uint32_t hash4(uint32_t v) {
+    return (v * 2654435761u) >> (32 - HASH_BITS);
+}
+
+/// Write the 255 continuation bytes of a length that didn't fit its nibble
+static unsigned char* put_length(unsigned char* op, long length) {
+    for (; length >= 255; length -= 255) *op++ = 255;
+    *op++ = (unsigned char) length;
+    return op;
+}
+
+long lz4_compress(unsigned char const* src, long size, unsigned char* dst, long capacity) {
+    if (capacity < lz4_bound(size)) return -1;
+
+    long table[1 << HASH_BITS];
+    for (long& t : table) t = -1;
+
+    unsigned char* op = dst;
+    long anchor = 0; // Start of the pending literals
+    long i = 0;
+
+    while (i + MF_LIMIT < size) {
+        uint32_t seq = read32(src + i);
+        uint32_t h   = hash4(seq);
+        long ref     = table[h];
+        table[h]     = i;
+
+        if (ref < 0 || i - ref > MAX_OFFSET || read32(src + ref) != seq) {
+            i++;
+            continue;
+        }
+
+        long match = MIN_MATCH;
+        while (i + match < size - LAST_LITERALS && src[ref + match] == src[i + match]) match++;
+
+        long literals = i - anchor;
+        long extra    = match - MIN_MATCH;
+
+        unsigned char* token = op++;
+        *token = (unsigned char) (((literals < 15 ? literals : 15) << 4) | (extra < 15 ? extra : 15));
+        if (literals >= 15) op = put_length(op, literals - 15);
+        memcpy(op, src + anchor, literals);
+        op += literals;
+
+        long offset = i - ref;
+        *op++ = offset & 0xff;
+        *op++ = offset >> 8;
+        if (extra >= 15) op = put_length(op, extra - 15);
+
+        i += match;
+        anchor = i;
+    }
+
+    // Whatever is left goes out as literals
+    long literals = size - anchor;
+    *op++ = (unsigned char) ((literals < 15 ? literals : 15) << 4);
+    if (literals >= 15) op = put_length(op, literals - 15);
+    memcpy(op, src + anchor, literals);
+    op += literals;
+
+    return op - dst;
+}
+
+long lz4_decompress(unsigned char const* src, long size, unsigned char* dst, long capacity) {
+    unsigned char const* ip     = src;
+    unsigned char const* iend   = src + size;
+    unsigned char* op           = dst;
+    unsigned char* oend         = dst + capacity;
+
+    while (ip < iend) {
+        int token = *ip++;
+
+        long literals = token >> 4;
+        if (literals == 15) {
+            int b;
+            do {
+                if (ip >= iend) return -1;
+                b = *ip++;
+                literals += b;
+            } while (b == 255);
+        }
+        if (literals > iend - ip || literals > oend - op) return -1;
+        memcpy(op, ip, literals);
+        ip += literals;
+        op += literals;
+
+        // The last sequence has no match
+        if (ip == iend) break;
+
+        if (iend - ip < 2) return -1;
+        long offset = ip[0] | (ip[1] << 8);
+        ip += 2;
+        if (offset == 0 || offset > op - dst) return -1;
+
+        long match = token & 15;
+        if (match == 15) {
+            int b;
+            do {
+                if (ip >= iend) return -1;
+                b = *ip++;
+                match += b;
+            } while (b == 255);
+        }
+        match += MIN_MATCH;
+        if (match > oend - op) return -1;
+
+        // Byte by byte, the match may overlap what it writes
+        unsigned char const* ref = op - offset;
+        for (long k = 0; k < match; k++) op[k] = ref[k];
+        op += match;
+    }
+
+    return op - dst;
+}
@@ -0,0 +1,17 @@
+#pragma once
+
+/// Worst case size of compressing n bytes
+constexpr long lz4_bound(long n) { return n + n / 255 + 16; }
+
+/**
+ * Compress to the LZ4 block format. Greedy and simple, meant for the
+ * offline packer, not for speed.
+ * @returns Compressed size, -1 if it doesn't fit capacity
+ */
+long lz4_compress(unsigned char const* src, long size, unsigned char* dst, long capacity);
+
+/**
+ * Decompress an LZ4 block.
+ * @returns Decompressed size, -1 if the block is malformed or doesn't fit capacity
+ */
+long lz4_decompress(unsigned char const* src, long size, unsigned char* dst, long capacity);
@@ -0,0 +1,112 @@
+#include "pack.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "lz4.h"
+
+/// Check the header and the index of pack->file and point into it
+static int pack_load(Pack* pack, char const* path) {
+    char const* data = pack->file.data;
+    long size        = pack->file.size;
+
+    PackHeader const* header = (PackHeader const*) data;
+    if (size < (long) sizeof(PackHeader)
+        || memcmp(header->magic, PACK_MAGIC, sizeof(PACK_MAGIC))
+        || header->version != PACK_VERSION
+        || (long) sizeof(PackHeader) + (long) header->count * (long) sizeof(PackEntry) + header->names_size > size) {
+        fprintf(stderr, "ERROR:PACK:HEADER %s\n", path);
+        release_file(&pack->file);
+        return -1;
+    }
+
+    pack->header  = header;
+    pack->entries = (PackEntry const*) (data + sizeof(PackHeader));
+    pack->names   = (char const*) (pack->entries + header->count);
+
+    // Check once, so lookups can trust the index
+    for (uint32_t i = 0; i < header->count; i++) {
+        PackEntry const* entry = &pack->entries[i];
+        if (entry->offset > (uint64_t) size || entry->size > size - entry->offset
+            || (uint64_t) entry->name_offset + entry->name_size > header->names_size
+            || (i > 0 && entry->hash < pack->entries[i - 1].hash)) {
+            fprintf(stderr, "ERROR:PACK:INDEX %s\n", path);
+            release_file(&pack->file);
+            *pack = {0};
+            return -1;
+        }
+    }
+    return 0;
+}
+
+int pack_open(char const* path, Pack* pack) {
+    *pack = {0};
+
+    int status = map_file(path, &pack->file);
+    if (status) return status;
+    return pack_load(pack, path);
+}
+
+int pack_open_memory(char const* data, long size, Pack* pack) {
+    *pack = {0};
+    pack->file.data     = data;
+    pack->file.size     = size;
+    pack->file.borrowed = true;
+    return pack_load(pack, "<memory>");
+}
+
+void pack_close(Pack* pack) {
+    release_file(&pack->file);
+    *pack = {0};
+}
+
+PackEntry const* pack_find(Pack const* pack, char const* path) {
+    long bytes    = strlen(path);
+    uint64_t hash = pack_hash(path, bytes);
+
+    // Lower bound of the hash
+    uint32_t low  = 0;
+    uint32_t high = pack->header->count;
+    while (low < high) {
+        uint32_t mid = low + (high - low) / 2;
+        if (pack->entries[mid].hash < hash) low = mid + 1;
+        else                                high = mid;
+    }
+
+    // Equal hashes are next to each other, the name decides
+    for (uint32_t i = low; i < pack->header->count && pack->entries[i].hash == hash; i++) {
+        PackEntry const* entry = &pack->entries[i];
+        if (entry->name_size == bytes && !memcmp(pack->names + entry->name_offset, path, bytes)) {
+            return entry;
+        }
+    }
+    return nullptr;
+}
+
+int pack_read(Pack const* pack, PackEntry const* entry, FileView* view) {
+    *view = {0};
+    char const* blob = pack->file.data + entry->offset;
+
+    if (!(entry->flags & PACK_LZ4)) {
+        view->data     = blob;
+        view->size     = entry->size;
+        view->borrowed = true;
+        return 0;
+    }
+
+    // Room for at least a byte, so an empty file isn't a failed malloc
+    char* data = (char*) malloc(entry->original_size + 1);
+    if (!data) return -1;
+
+    long size = lz4_decompress((unsigned char const*) blob, entry->size, (unsigned char*) data, entry->original_size);
+    if (size != entry->original_size) {
+        fprintf(stderr, "ERROR:PACK:DECOMPRESS %.*s\n", (int) entry->name_size, pack->names + entry->name_offset);
+        free(data);
+        return -1;
+    }
+
+    view->data = data;
+    view->size = size;
+    return 0;
+}
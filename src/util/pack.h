@@ -0,0 +1,79 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "file.h"
+
+// Layout of a pack, all little endian:
+//   PackHeader
+//   PackEntry[count]   sorted by hash
+//   names              the paths, not terminated, for listing and to tell hash collisions apart
+//   blobs              each starting at a multiple of PACK_ALIGN
+constexpr char     PACK_MAGIC[4] = { 'P', 'O', 'N', 'G' };
+constexpr uint32_t PACK_VERSION  = 1;
+constexpr long     PACK_ALIGN    = 16;
+
+constexpr uint32_t PACK_LZ4 = 1; // The blob is an LZ4 block
+
+struct PackHeader {
+    char     magic[4];
+    uint32_t version;
+    uint32_t count;         // Entries in the index
+    uint32_t names_size;    // Bytes of the names right after the index
+};
+
+struct PackEntry {
+    uint64_t hash;          // pack_hash() of the path
+    uint64_t offset;        // Of the blob, from the start of the pack
+    uint32_t size;          // Bytes of the blob
+    uint32_t original_size; // Bytes once decompressed
+    uint32_t flags;
+    uint32_t name_offset;   // Into the names
+    uint32_t name_size;
+    uint32_t reserved;
+};
+
+/// An archive mapped in one go, the index is read in place
+struct Pack {
+    FileView         file;
+    PackHeader const* header;
+    PackEntry const* entries;
+    char const*      names;
+};
+
+constexpr uint64_t FNV_OFFSET = 14695981039346656037ull;
+
+/// FNV-1a, 64 bit. Pass the hash of what came before to hash several
+/// pieces as one.
+inline uint64_t pack_hash(char const* data, long size, uint64_t hash = FNV_OFFSET) {
+    for (long i = 0; i < size; i++) {
+        hash ^= (unsigned char) data[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+/**
+ * Map the archive and check its header and index.
+ * @returns 0 on success
+ */
+int pack_open(char const* path, Pack* pack);
+
+/// Use a pack that is already in memory, like one built into the
+/// binary. data has to be 8 byte aligned and outlive the pack.
+int pack_open_memory(char const* data, long size, Pack* pack);
+void pack_close(Pack* pack);
+
+/**
+ * Binary search the index for path.
+ * @returns The entry, null if the pack doesn't have it
+ */
+PackEntry const* pack_find(Pack const* pack, char const* path);
+
+/**
+ * @param view Receives the content. Points into the mapping for stored
+ *        entries, compressed ones are decompressed to the heap.
+ *        Release with release_file() before closing the pack.
+ * @returns 0 on success
+ */
+int pack_read(Pack const* pack, PackEntry const* entry, FileView* view);
@@ -0,0 +1,194 @@
+#include "profiler.h"
+
+#include <string.h>
+#include <time.h>
+
+#include <algorithm>
+#include <atomic>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define PROFILER_TSC
+#endif
+
+struct ZoneEvent {
+    char const* name;
+    uint64_t    start;
+    uint64_t    end;
+};
+
+/// Ring of a thread or a named track. Only one thread writes, head is
+/// published with release so readers see whole events below it.
+struct ProfileTrack {
+    ZoneEvent             events[PROFILE_RING];
+    std::atomic<uint64_t> head;         // Events ever recorded
+    uint64_t              reported;     // head at the last report
+    int                   id;
+    char const*           name;         // Null for threads
+    ProfileTrack*         next;
+};
+
+// Rings of all the threads and of the named tracks, pushed lock free
+// and never freed, so the rings of finished threads can still be dumped
+static std::atomic<ProfileTrack*> RINGS;
+static std::atomic<int>         THREADS;
+
+static uint64_t clock_ns() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+uint64_t profiler_now() {
+#ifdef PROFILER_TSC
+    return __rdtsc();
+#else
+    return clock_ns();
+#endif
+}
+
+// Taken when the program is loaded, before main()
+struct TimeBase {
+    uint64_t ticks;
+    uint64_t ns;
+};
+static TimeBase const BASE = { profiler_now(), clock_ns() };
+
+/// Nanoseconds a tick takes, measured over the whole run so far
+static double ns_per_tick() {
+#ifdef PROFILER_TSC
+    uint64_t ticks = profiler_now() - BASE.ticks;
+    uint64_t ns    = clock_ns() - BASE.ns;
+    return ticks ? (double) ns / ticks : 1.0;
+#else
+    return 1.0;
+#endif
+}
+
+uint64_t profiler_ticks_at(uint64_t ns) {
+#ifdef PROFILER_TSC
+    return BASE.ticks + (uint64_t) (((double) ns - (double) BASE.ns) / ns_per_tick());
+#else
+    return ns;
+#endif
+}
+
+static ProfileTrack* new_track(char const* name) {
+    ProfileTrack* ring = new ProfileTrack();
+    ring->id   = THREADS.fetch_add(1);
+    ring->name = name;
+    ring->next = RINGS.load(std::memory_order_relaxed);
+    while (!RINGS.compare_exchange_weak(ring->next, ring, std::memory_order_release, std::memory_order_relaxed)) {}
+    return ring;
+}
+
+ProfileTrack* profiler_track(char const* name) {
+    return new_track(name);
+}
+
+static ProfileTrack* thread_ring() {
+    thread_local ProfileTrack* ring = nullptr;
+    if (!ring) ring = new_track(nullptr);
+    return ring;
+}
+
+void profiler_record(char const* name, uint64_t start, uint64_t end) {
+    profiler_record_track(thread_ring(), name, start, end);
+}
+
+void profiler_record_track(ProfileTrack* ring, char const* name, uint64_t start, uint64_t end) {
+    uint64_t head = ring->head.load(std::memory_order_relaxed);
+    ring->events[head % PROFILE_RING] = { name, start, end };
+    ring->head.store(head + 1, std::memory_order_release);
+}
+
+struct ZoneStats {
+    char const*         name;
+    std::vector<double> durations; // Milliseconds
+};
+
+void profiler_report(FILE* out) {
+    double scale = ns_per_tick() * 1e-6;
+    std::vector<ZoneStats> zones;
+
+    for (ProfileTrack* ring = RINGS.load(std::memory_order_acquire); ring; ring = ring->next) {
+        uint64_t head  = ring->head.load(std::memory_order_acquire);
+        uint64_t first = std::max(ring->reported, head > PROFILE_RING ? head - PROFILE_RING : 0);
+        ring->reported = head;
+
+        // Published events are only rewritten once the writer laps the
+        // ring. Copy them, then drop the ones it may have reached meanwhile.
+        std::vector<ZoneEvent> events;
+        for (uint64_t i = first; i < head; i++) events.push_back(ring->events[i % PROFILE_RING]);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        uint64_t now_head = ring->head.load(std::memory_order_relaxed);
+
+        for (uint64_t i = first; i < head; i++) {
+            if (i + PROFILE_RING <= now_head) continue;
+            ZoneEvent const& event = events[i - first];
+
+            // Few zones, a linear search beats hashing
+            ZoneStats* zone = nullptr;
+            for (ZoneStats& z : zones) {
+                if (z.name == event.name || !strcmp(z.name, event.name)) zone = &z;
+            }
+            if (!zone) {
+                zones.push_back({ event.name, {} });
+                zone = &zones.back();
+            }
+            zone->durations.push_back((event.end - event.start) * scale);
+        }
+    }
+
+    fprintf(out, "%-20s %8s %10s %10s %10s %10s\n", "zone", "count", "min ms", "p50 ms", "avg ms", "p99 ms");
+    for (ZoneStats& zone : zones) {
+        std::vector<double>& d = zone.durations;
+        double sum = 0;
+        for (double x : d) sum += x;
+
+        std::sort(d.begin(), d.end());
+        double p50_ms = d[d.size() / 2];
+        double p99_ms = d[d.size() * 99 / 100];
+
+        fprintf(out, "%-20s %8zu %10.4f %10.4f %10.4f %10.4f\n", zone.name, d.size(), d[0], p50_ms, sum / d.size(), p99_ms);
+    }
+}
+
+int profiler_write_trace(char const* path) {
+    FILE* out = fopen(path, "w");
+    if (!out) {
+        fprintf(stderr, "ERROR:PROFILER:OPEN %s\n", path);
+        return -1;
+    }
+
+    double scale = ns_per_tick() * 1e-3; // Trace events are in microseconds
+    bool first = true;
+
+    fputs("{\"traceEvents\":[\n", out);
+    for (ProfileTrack* ring = RINGS.load(std::memory_order_acquire); ring; ring = ring->next) {
+        uint64_t head  = ring->head.load(std::memory_order_acquire);
+        uint64_t begin = head > PROFILE_RING ? head - PROFILE_RING : 0;
+
+        if (ring->name) {
+            fprintf(out, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"%s\"}}",
+                    first ? "" : ",\n", ring->id, ring->name);
+            first = false;
+        }
+
+        for (uint64_t i = begin; i < head; i++) {
+            ZoneEvent const& event = ring->events[i % PROFILE_RING];
+            fprintf(out, "%s{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}",
+                    first ? "" : ",\n", event.name, ring->id,
+                    (int64_t) (event.start - BASE.ticks) * scale, (event.end - event.start) * scale);
+            first = false;
+        }
+    }
+    fputs("\n]}\n", out);
+
+    if (fclose(out)) {
+        fprintf(stderr, "ERROR:PROFILER:WRITE %s\n", path);
+        return -1;
+    }
+    return 0;
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+
+// Scoped zones, compiled in with 'make PROFILE=1'. Without it
+// PROFILE_ZONE expands to nothing and costs nothing.
+//
+//     void update() {
+//         PROFILE_ZONE("update");
+//         ...
+//     }
+//
+// Every thread records into its own ring, so recording takes no lock.
+// Zone names have to be string literals, they are kept as pointers.
+
+constexpr int PROFILE_RING = 1 << 16; // Zones a thread keeps, older ones are overwritten
+
+/// Timestamp in ticks: the TSC on x86, nanoseconds elsewhere
+uint64_t profiler_now();
+
+/// Ticks at a CLOCK_MONOTONIC time in nanoseconds
+uint64_t profiler_ticks_at(uint64_t ns);
+
+/// Record a zone of the calling thread that ran from start to end ticks
+void profiler_record(char const* name, uint64_t start, uint64_t end);
+
+/// Row of zones of something other than a CPU thread, like the GPU
+struct ProfileTrack;
+
+/// @param name Of the row in the trace, a string literal
+ProfileTrack* profiler_track(char const* name);
+
+/// Like profiler_record(), into a track. Only one thread may record
+/// into a track.
+void profiler_record_track(ProfileTrack* track, char const* name, uint64_t start, uint64_t end);
+
+/**
+ * Print min/p50/avg/p99 of every zone recorded since the last report.
+ * Other threads may keep recording meanwhile, zones they overwrite
+ * while the report reads them are left out. Don't call concurrently
+ * with itself or profiler_write_trace().
+ */
+void profiler_report(FILE* out);
+
+/**
+ * Write the zones the rings hold in the Chrome trace event format, for
+ * chrome://tracing or ui.perfetto.dev. Best done when the other
+ * threads are idle, zones recorded meanwhile may come out torn.
+ * @returns 0 on success
+ */
+int profiler_write_trace(char const* path);
+
+struct ProfileZone {
+    char const* name;
+    uint64_t    start;
+
+    ProfileZone(char const* name) : name(name), start(profiler_now()) {}
+    ~ProfileZone() { profiler_record(name, start, profiler_now()); }
+};
+
+#ifdef PROFILER
+constexpr bool PROFILER_ENABLED = true;
+#define PROFILE_CONCAT_(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_(a, b)
+#define PROFILE_ZONE(name) ProfileZone PROFILE_CONCAT(profile_zone_, __LINE__)(name)
+#else
+constexpr bool PROFILER_ENABLED = false;
+#define PROFILE_ZONE(name) ((void) 0)
+#endif